@@ -0,0 +1,548 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/bitmap.c
+ *
+ * Key presence bitmap for 32-bit key tables
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file bitmap.c
+  * @date 18 Oct 2026
+  * @brief Compressed (roaring) bitmap of the keys present in tables with 32-bit keys and the "bitmap" option
+
+  * The 32-bit key space is split into 65536 containers by the upper 16 bits of the key. A container holds
+  * the lower 16 bits of its keys either as a sorted array (up to 4096 keys) or as a 65536-bit bitmap. The
+  * whole index is kept in memory, so ldb_key_exists() is answered without any I/O.
+
+  * The bitmap is rebuilt by collate into DBNAME/TABLENAME.bmp. Keys added by inserts or removed by unlinks
+  * in between are appended to DBNAME/TABLENAME.bmp.log (O = 1 for add or 0 for remove, followed by the key).
+
+  * BITMAP FILE STRUCTURE
+  * M = "LDBR" magic
+  * N = 32-bit number of containers
+  * Containers:
+  * H = 16-bit upper key bits
+  * C = 32-bit number of keys in the container
+  * D = C 16-bit values if C <= 4096, or a 8192 byte bitmap otherwise
+  * @see https://github.com/scanoss/ldb/blob/master/src/bitmap.c
+  */
+
+#define LDB_BMP_MAGIC "LDBR"
+#define LDB_BMP_ARRAY_MAX 4096
+#define LDB_BMP_WORDS 1024
+#define LDB_BMP_CACHE 64
+#define LDB_BMP_REVALIDATE_SEC 1
+
+struct ldb_bitmap_container
+{
+	uint32_t count;
+	uint32_t capacity;
+	uint16_t *array; // sorted lower 16 bits (when count <= LDB_BMP_ARRAY_MAX)
+	uint64_t *bits;  // 65536-bit bitmap (otherwise)
+};
+
+struct ldb_bitmap
+{
+	struct ldb_bitmap_container *c[65536];
+};
+
+struct ldb_bitmap_cache
+{
+	char path[LDB_MAX_PATH];
+	struct ldb_bitmap *bitmap;
+	time_t checked;
+	time_t mtime;
+	off_t log_size;
+};
+
+struct ldb_bitmap_cache ldb_bitmaps[LDB_BMP_CACHE];
+pthread_mutex_t ldb_bitmap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Allocates an empty bitmap
+ *
+ * @return pointer to the new bitmap
+ */
+struct ldb_bitmap *ldb_bitmap_new(void)
+{
+	return calloc(1, sizeof(struct ldb_bitmap));
+}
+
+/**
+ * @brief Converts a 32-bit LDB key into an integer
+ *
+ * @param key key
+ * @return uint32_t key value
+ */
+uint32_t ldb_bitmap_key(uint8_t *key)
+{
+	return ((uint32_t) key[0] << 24) | ((uint32_t) key[1] << 16) | ((uint32_t) key[2] << 8) | key[3];
+}
+
+/**
+ * @brief Returns the position of value in a sorted container array (or where it should be inserted)
+ *
+ * @param c container
+ * @param value lower 16 bits of the key
+ * @return position
+ */
+uint32_t ldb_bitmap_array_pos(struct ldb_bitmap_container *c, uint16_t value)
+{
+	uint32_t lo = 0;
+	uint32_t hi = c->count;
+	while (lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (c->array[mid] < value) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/**
+ * @brief Converts an array container into a bitmap container
+ *
+ * @param c container
+ */
+void ldb_bitmap_to_bits(struct ldb_bitmap_container *c)
+{
+	c->bits = calloc(LDB_BMP_WORDS, sizeof(uint64_t));
+	for (uint32_t i = 0; i < c->count; i++) c->bits[c->array[i] >> 6] |= (1ULL << (c->array[i] & 63));
+	free(c->array);
+	c->array = NULL;
+	c->capacity = 0;
+}
+
+/**
+ * @brief Adds a key to the bitmap
+ *
+ * @param bitmap bitmap
+ * @param value key value
+ */
+void ldb_bitmap_add(struct ldb_bitmap *bitmap, uint32_t value)
+{
+	struct ldb_bitmap_container *c = bitmap->c[value >> 16];
+	uint16_t low = value & 0xffff;
+
+	if (!c)
+	{
+		c = calloc(1, sizeof(struct ldb_bitmap_container));
+		bitmap->c[value >> 16] = c;
+	}
+
+	if (c->bits)
+	{
+		uint64_t bit = 1ULL << (low & 63);
+		if (!(c->bits[low >> 6] & bit)) c->count++;
+		c->bits[low >> 6] |= bit;
+		return;
+	}
+
+	uint32_t pos = ldb_bitmap_array_pos(c, low);
+	if (pos < c->count && c->array[pos] == low) return;
+
+	if (c->count == LDB_BMP_ARRAY_MAX)
+	{
+		ldb_bitmap_to_bits(c);
+		ldb_bitmap_add(bitmap, value);
+		return;
+	}
+
+	if (c->count == c->capacity)
+	{
+		c->capacity = c->capacity ? c->capacity * 2 : 16;
+		c->array = realloc(c->array, c->capacity * sizeof(uint16_t));
+	}
+	memmove(c->array + pos + 1, c->array + pos, (c->count - pos) * sizeof(uint16_t));
+	c->array[pos] = low;
+	c->count++;
+}
+
+/**
+ * @brief Removes a key from the bitmap
+ *
+ * @param bitmap bitmap
+ * @param value key value
+ */
+void ldb_bitmap_remove(struct ldb_bitmap *bitmap, uint32_t value)
+{
+	struct ldb_bitmap_container *c = bitmap->c[value >> 16];
+	uint16_t low = value & 0xffff;
+	if (!c) return;
+
+	if (c->bits)
+	{
+		uint64_t bit = 1ULL << (low & 63);
+		if (c->bits[low >> 6] & bit) c->count--;
+		c->bits[low >> 6] &= ~bit;
+		return;
+	}
+
+	uint32_t pos = ldb_bitmap_array_pos(c, low);
+	if (pos >= c->count || c->array[pos] != low) return;
+	memmove(c->array + pos, c->array + pos + 1, (c->count - pos - 1) * sizeof(uint16_t));
+	c->count--;
+}
+
+/**
+ * @brief Checks if a key is in the bitmap
+ *
+ * @param bitmap bitmap
+ * @param value key value
+ * @return true if the key is present
+ */
+bool ldb_bitmap_contains(struct ldb_bitmap *bitmap, uint32_t value)
+{
+	struct ldb_bitmap_container *c = bitmap->c[value >> 16];
+	uint16_t low = value & 0xffff;
+	if (!c) return false;
+
+	if (c->bits) return (c->bits[low >> 6] >> (low & 63)) & 1;
+
+	uint32_t pos = ldb_bitmap_array_pos(c, low);
+	return (pos < c->count && c->array[pos] == low);
+}
+
+/**
+ * @brief Removes all keys of a sector (first key byte) from the bitmap
+ *
+ * @param bitmap bitmap
+ * @param k0 sector
+ */
+void ldb_bitmap_clear_sector(struct ldb_bitmap *bitmap, uint8_t k0)
+{
+	for (int i = 0; i < 256; i++)
+	{
+		struct ldb_bitmap_container *c = bitmap->c[(k0 << 8) | i];
+		if (!c) continue;
+		free(c->array);
+		free(c->bits);
+		free(c);
+		bitmap->c[(k0 << 8) | i] = NULL;
+	}
+}
+
+/**
+ * @brief Sets the keys of a sector in the bitmap from the list pointers in the sector map. Used for the
+ * sectors which a resumed collate does not read again.
+ *
+ * @param table table struct
+ * @param bitmap bitmap
+ * @param k0 sector
+ */
+void ldb_bitmap_load_sector(struct ldb_table table, struct ldb_bitmap *bitmap, uint8_t k0)
+{
+	ldb_bitmap_clear_sector(bitmap, k0);
+
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/%s/%s/%02x.ldb", ldb_root, table.db, table.table, k0);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return;
+
+	/* The map holds a pointer for each key, in key order, read here 65536 keys at a time */
+	uint8_t *map = malloc(65536 * LDB_PTR_LN);
+	for (int k1 = 0; k1 < 256; k1++)
+	{
+		if (pread(fd, map, 65536 * LDB_PTR_LN, (uint64_t) k1 * 65536 * LDB_PTR_LN) != 65536 * LDB_PTR_LN) break;
+		for (int i = 0; i < 65536; i++)
+			if (uint40_read(map + i * LDB_PTR_LN)) ldb_bitmap_add(bitmap, ((uint32_t) k0 << 24) | (k1 << 16) | i);
+	}
+	free(map);
+	close(fd);
+}
+
+/**
+ * @brief Frees a bitmap
+ *
+ * @param bitmap bitmap
+ */
+void ldb_bitmap_free(struct ldb_bitmap *bitmap)
+{
+	if (!bitmap) return;
+	for (int k0 = 0; k0 < 256; k0++) ldb_bitmap_clear_sector(bitmap, k0);
+	free(bitmap);
+}
+
+/**
+ * @brief Returns the path to the table bitmap file
+ *
+ * @param table table struct
+ * @param path[out] output path (LDB_MAX_PATH)
+ * @param ext file extension
+ */
+void ldb_bitmap_path(struct ldb_table table, char *path, char *ext)
+{
+	sprintf(path, "%s/%s/%s.%s", ldb_root, table.db, table.table, ext);
+}
+
+/**
+ * @brief Loads the table bitmap, applying the log of changes since it was last saved
+ *
+ * @param table table struct
+ * @return pointer to the bitmap, or NULL if the table has no bitmap yet
+ */
+struct ldb_bitmap *ldb_bitmap_load(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	ldb_bitmap_path(table, path, "bmp");
+
+	if (!ldb_file_exists(path)) return NULL;
+	uint64_t size = 0;
+	uint8_t *data = file_read(path, &size);
+
+	struct ldb_bitmap *bitmap = NULL;
+
+	if (size >= 8 && !memcmp(data, LDB_BMP_MAGIC, 4))
+	{
+		bitmap = ldb_bitmap_new();
+		uint32_t containers = uint32_read(data + 4);
+		uint64_t ptr = 8;
+
+		for (uint32_t i = 0; i < containers && ptr + 6 <= size; i++)
+		{
+			uint16_t high = uint16_read(data + ptr);
+			uint32_t count = uint32_read(data + ptr + 2);
+			ptr += 6;
+
+			struct ldb_bitmap_container *c = calloc(1, sizeof(struct ldb_bitmap_container));
+			c->count = count;
+			if (count <= LDB_BMP_ARRAY_MAX)
+			{
+				if (ptr + count * 2 > size) break;
+				c->capacity = count;
+				c->array = malloc(count * sizeof(uint16_t) + 1);
+				memcpy(c->array, data + ptr, count * 2);
+				ptr += count * 2;
+			}
+			else
+			{
+				if (ptr + LDB_BMP_WORDS * 8 > size) break;
+				c->bits = malloc(LDB_BMP_WORDS * sizeof(uint64_t));
+				memcpy(c->bits, data + ptr, LDB_BMP_WORDS * 8);
+				ptr += LDB_BMP_WORDS * 8;
+			}
+			free(bitmap->c[high]);
+			bitmap->c[high] = c;
+		}
+	}
+	else printf("E079 Corrupted file %s\n", path);
+	free(data);
+
+	if (!bitmap) return NULL;
+
+	/* Apply log */
+	ldb_bitmap_path(table, path, "bmp.log");
+	if (ldb_file_exists(path))
+	{
+		data = file_read(path, &size);
+		for (uint64_t ptr = 0; ptr + 1 + LDB_KEY_LN <= size; ptr += 1 + LDB_KEY_LN)
+		{
+			if (data[ptr]) ldb_bitmap_add(bitmap, ldb_bitmap_key(data + ptr + 1));
+			else ldb_bitmap_remove(bitmap, ldb_bitmap_key(data + ptr + 1));
+		}
+		free(data);
+	}
+
+	return bitmap;
+}
+
+/**
+ * @brief Saves the table bitmap and empties its log
+ *
+ * @param table table struct
+ * @param bitmap bitmap
+ */
+void ldb_bitmap_save(struct ldb_table table, struct ldb_bitmap *bitmap)
+{
+	char path[LDB_MAX_PATH];
+	char tmp_path[LDB_MAX_PATH];
+	ldb_bitmap_path(table, path, "bmp");
+	ldb_bitmap_path(table, tmp_path, "bmp.tmp");
+
+	FILE *out = fopen(tmp_path, "w");
+	if (!out)
+	{
+		printf("E065 Cannot create %s\n", tmp_path);
+		return;
+	}
+
+	uint32_t containers = 0;
+	for (int i = 0; i < 65536; i++) if (bitmap->c[i] && bitmap->c[i]->count) containers++;
+
+	uint8_t header[8];
+	memcpy(header, LDB_BMP_MAGIC, 4);
+	uint32_write(header + 4, containers);
+	fwrite(header, 1, 8, out);
+
+	for (int i = 0; i < 65536; i++)
+	{
+		struct ldb_bitmap_container *c = bitmap->c[i];
+		if (!c || !c->count) continue;
+
+		uint8_t head[6];
+		uint16_write(head, i);
+		uint32_write(head + 2, c->count);
+		fwrite(head, 1, 6, out);
+
+		/* Containers are written as arrays whenever they fit */
+		if (c->count <= LDB_BMP_ARRAY_MAX)
+		{
+			if (c->array) fwrite(c->array, 2, c->count, out);
+			else for (int v = 0; v < 65536; v++) if ((c->bits[v >> 6] >> (v & 63)) & 1)
+			{
+				uint16_t value = v;
+				fwrite(&value, 2, 1, out);
+			}
+		}
+		else fwrite(c->bits, 8, LDB_BMP_WORDS, out);
+	}
+
+	fclose(out);
+	if (rename(tmp_path, path)) printf("Warning: cannot write %s\n", path);
+
+	/* Changes are now in the bitmap */
+	ldb_bitmap_path(table, path, "bmp.log");
+	unlink(path);
+}
+
+/**
+ * @brief Applies a logged change to the bitmap cached by this process, so that its own inserts and unlinks
+ * are seen at once rather than at the next revalidation
+ *
+ * @param table table struct
+ * @param key key
+ * @param add true if the key was added, false if it was removed
+ */
+void ldb_bitmap_cache_update(struct ldb_table table, uint8_t *key, bool add)
+{
+	char path[LDB_MAX_PATH];
+	ldb_bitmap_path(table, path, "bmp");
+
+	pthread_mutex_lock(&ldb_bitmap_lock);
+	for (int i = 0; i < LDB_BMP_CACHE; i++)
+	{
+		struct ldb_bitmap_cache *cache = ldb_bitmaps + i;
+		if (!*cache->path || strcmp(cache->path, path)) continue;
+
+		/* The entry is in the log now, so the log size no longer tells of a change by another process */
+		if (cache->bitmap)
+		{
+			if (add) ldb_bitmap_add(cache->bitmap, ldb_bitmap_key(key));
+			else ldb_bitmap_remove(cache->bitmap, ldb_bitmap_key(key));
+			cache->log_size += 1 + LDB_KEY_LN;
+		}
+
+		/* A bitmap saved since the last check is loaded on the next call */
+		else cache->checked = 0;
+		break;
+	}
+	pthread_mutex_unlock(&ldb_bitmap_lock);
+}
+
+/**
+ * @brief Logs a key added to (or removed from) a table with the "bitmap" option
+ *
+ * @param table table struct
+ * @param key key
+ * @param add true if the key was added, false if it was removed
+ */
+void ldb_bitmap_log(struct ldb_table table, uint8_t *key, bool add)
+{
+	if (!table.bitmap || table.tmp || table.key_ln != LDB_KEY_LN) return;
+
+	char path[LDB_MAX_PATH];
+	ldb_bitmap_path(table, path, "bmp");
+	if (!ldb_file_exists(path)) return;
+
+	ldb_bitmap_path(table, path, "bmp.log");
+	int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (fd < 0) return;
+
+	uint8_t entry[1 + LDB_KEY_LN];
+	entry[0] = add;
+	memcpy(entry + 1, key, LDB_KEY_LN);
+	if (write(fd, entry, sizeof(entry)) != sizeof(entry)) printf("Warning: cannot write %s\n", path);
+	close(fd);
+
+	ldb_bitmap_cache_update(table, key, add);
+}
+
+/**
+ * @brief Checks the key presence bitmap for a key. The bitmap is kept in memory and only checked for
+ * changes on disk once every LDB_BMP_REVALIDATE_SEC seconds. Changes logged by this process are applied
+ * to it directly (see ldb_bitmap_log).
+ *
+ * @param table table struct
+ * @param key key
+ * @return 1 if the key is present, 0 if it is not, -1 if there is no bitmap for the table
+ */
+int ldb_bitmap_key_exists(struct ldb_table table, uint8_t *key)
+{
+	char path[LDB_MAX_PATH];
+	ldb_bitmap_path(table, path, "bmp");
+
+	int out = -1;
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&ldb_bitmap_lock);
+
+	/* Find table in cache */
+	int slot = -1;
+	for (int i = 0; i < LDB_BMP_CACHE; i++)
+	{
+		if (!*ldb_bitmaps[i].path)
+		{
+			if (slot < 0) slot = i;
+		}
+		else if (!strcmp(ldb_bitmaps[i].path, path))
+		{
+			slot = i;
+			break;
+		}
+	}
+
+	if (slot >= 0)
+	{
+		struct ldb_bitmap_cache *cache = ldb_bitmaps + slot;
+
+		/* Reload if the bitmap or its log changed */
+		if (!*cache->path || now - cache->checked >= LDB_BMP_REVALIDATE_SEC)
+		{
+			struct stat st;
+			time_t mtime = stat(path, &st) ? 0 : st.st_mtime;
+			char log_path[LDB_MAX_PATH];
+			ldb_bitmap_path(table, log_path, "bmp.log");
+			off_t log_size = stat(log_path, &st) ? 0 : st.st_size;
+
+			if (!*cache->path || mtime != cache->mtime || log_size != cache->log_size)
+			{
+				ldb_bitmap_free(cache->bitmap);
+				cache->bitmap = mtime ? ldb_bitmap_load(table) : NULL;
+				cache->mtime = mtime;
+				cache->log_size = log_size;
+				strcpy(cache->path, path);
+			}
+			cache->checked = now;
+		}
+
+		if (cache->bitmap) out = ldb_bitmap_contains(cache->bitmap, ldb_bitmap_key(key));
+	}
+
+	pthread_mutex_unlock(&ldb_bitmap_lock);
+	return out;
+}
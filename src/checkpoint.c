@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/checkpoint.c
+ *
+ * Collate checkpoints
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file checkpoint.c
+  * @date 18 Oct 2026
+  * @brief Records the progress of a collate, so that an interrupted collate resumes where it stopped
+
+  * A full collate writes DBNAME/TABLENAME.collate when it starts, and appends a line for each sector
+  * once its .tmp has replaced the .ldb. The file is removed when the collate completes. A collate which
+  * finds the file skips the sectors listed in it. Leftover .tmp sectors are removed, unless their .ldb
+  * is missing, in which case the collate was interrupted while replacing the sector and the .tmp is
+  * the collated sector.
+
+  * CHECKPOINT FILE STRUCTURE (text)
+  * start EPOCH sectors COUNT bytes BYTES
+  * sector XX records RECORDS bytes BYTES seconds SECONDS
+  * ...
+  * @see https://github.com/scanoss/ldb/blob/master/src/checkpoint.c
+  */
+
+/**
+ * @brief Returns the path of a sector file
+ *
+ * @param table table struct config
+ * @param sector sector number
+ * @param ext file extension (ldb or tmp)
+ * @param path[out] path
+ */
+void ldb_checkpoint_sector_path(struct ldb_table table, int sector, char *ext, char *path)
+{
+	sprintf(path, "%s/%s/%s/%02x.%s", ldb_root, table.db, table.table, sector, ext);
+}
+
+/**
+ * @brief Loads the sectors already collated from the checkpoint file
+ *
+ * @param table table struct config
+ * @param done[out] array of 256 flags, set for the collated sectors
+ * @return true if there is a checkpoint
+ */
+bool ldb_checkpoint_load(struct ldb_table table, bool *done)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "collate");
+
+	FILE *fp = fopen(path, "r");
+	if (!fp) return false;
+
+	char line[256];
+	unsigned int sector;
+	while (fgets(line, sizeof(line), fp))
+		if (sscanf(line, "sector %x", &sector) == 1 && sector < 256) done[sector] = true;
+
+	fclose(fp);
+	return true;
+}
+
+/**
+ * @brief Writes a new checkpoint file, with the number and size of the sectors to be collated
+ *
+ * @param table table struct config
+ */
+void ldb_checkpoint_start(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	int sectors = 0;
+	uint64_t bytes = 0;
+
+	for (int i = 0; i < 256; i++)
+	{
+		ldb_checkpoint_sector_path(table, i, "ldb", path);
+		if (!ldb_file_exists(path)) continue;
+		sectors++;
+		bytes += ldb_file_size(path);
+	}
+
+	ldb_wal_path(table, path, "collate");
+	FILE *fp = fopen(path, "w");
+	if (!fp) ldb_error("E065 Cannot write collate checkpoint");
+	fprintf(fp, "start %ld sectors %d bytes %lu\n", (long) time(NULL), sectors, bytes);
+	fclose(fp);
+}
+
+/**
+ * @brief Records a collated sector in the checkpoint file
+ *
+ * @param table table struct config
+ * @param sector sector number
+ * @param records number of records
+ * @param bytes size of the sector before collate
+ * @param seconds time taken
+ */
+void ldb_checkpoint_sector(struct ldb_table table, int sector, long records, uint64_t bytes, long seconds)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "collate");
+
+	FILE *fp = fopen(path, "a");
+	if (!fp) ldb_error("E065 Cannot write collate checkpoint");
+	fprintf(fp, "sector %02x records %ld bytes %lu seconds %ld\n", sector, records, bytes, seconds);
+	fflush(fp);
+	fsync(fileno(fp));
+	fclose(fp);
+}
+
+/**
+ * @brief Removes the checkpoint file once the collate is completed
+ *
+ * @param table table struct config
+ */
+void ldb_checkpoint_clear(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "collate");
+	unlink(path);
+}
+
+/**
+ * @brief Removes the .tmp sectors left by an interrupted collate. A .tmp without its .ldb replaces it,
+ * and the sector is marked as collated.
+ *
+ * @param table table struct config
+ * @param done[in,out] array of 256 flags, set for the collated sectors
+ */
+void ldb_checkpoint_cleanup(struct ldb_table table, bool *done)
+{
+	char tmp[LDB_MAX_PATH];
+	char ldb[LDB_MAX_PATH];
+
+	for (int i = 0; i < 256; i++)
+	{
+		ldb_checkpoint_sector_path(table, i, "tmp", tmp);
+		if (!ldb_file_exists(tmp)) continue;
+
+		ldb_checkpoint_sector_path(table, i, "ldb", ldb);
+		if (ldb_file_exists(ldb))
+		{
+			printf("Removing orphan sector %02x.tmp\n", i);
+			unlink(tmp);
+		}
+		else
+		{
+			printf("Recovering collated sector %02x\n", i);
+			if (rename(tmp, ldb)) ldb_error("E074 Error replacing sector with .tmp");
+			if (!done[i]) ldb_checkpoint_sector(table, i, 0, 0, 0);
+			done[i] = true;
+		}
+	}
+}
+
+/**
+ * @brief Shows the progress of a collate, with an estimate of the remaining time from the throughput
+ * of the sectors collated so far
+ *
+ * @param table table struct config
+ */
+void ldb_checkpoint_status(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "collate");
+
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+	{
+		printf("No collate in progress for %s/%s\n", table.db, table.table);
+		return;
+	}
+
+	char line[256];
+	long start = 0;
+	int sectors = 0;
+	uint64_t total_bytes = 0;
+	int done = 0;
+	uint64_t done_bytes = 0;
+	long done_seconds = 0;
+	long done_records = 0;
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		unsigned int sector;
+		long records;
+		uint64_t bytes;
+		long seconds;
+
+		if (sscanf(line, "start %ld sectors %d bytes %lu", &start, &sectors, &total_bytes) == 3) continue;
+		if (sscanf(line, "sector %x records %ld bytes %lu seconds %ld", &sector, &records, &bytes, &seconds) == 4)
+		{
+			done++;
+			done_bytes += bytes;
+			done_seconds += seconds;
+			done_records += records;
+		}
+	}
+	fclose(fp);
+
+	setlocale(LC_NUMERIC, "");
+	printf("Collate of %s/%s started %ld seconds ago\n", table.db, table.table, (long) time(NULL) - start);
+	printf("%d of %d sectors done (%'lu of %'lu bytes, %'ld records)\n", done, sectors, done_bytes, total_bytes, done_records);
+
+	if (done_seconds && done_bytes)
+	{
+		double throughput = (double) done_bytes / done_seconds;
+		uint64_t remaining = total_bytes > done_bytes ? total_bytes - done_bytes : 0;
+		long eta = (long) (remaining / throughput);
+		printf("Throughput %'.0f bytes/s, ETA %ld:%02ld:%02ld\n", throughput, eta / 3600, (eta / 60) % 60, eta % 60);
+	}
+	else printf("Throughput not measured yet\n");
+}
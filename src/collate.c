@@ -51,6 +51,19 @@ int ldb_collate_cmp(const void * a, const void * b)
     return 0;
 }
 
+/**
+ * @brief ldb_collate_cmp with the signature of qsort_r (for ldb_sort)
+ *
+ * @param a block a
+ * @param b block b
+ * @param ptr unused
+ * @return 1 if a is bigger than b, -1 if b is bigger tha a, or 0 if they are equals.
+ */
+int ldb_collate_cmp_r(const void *a, const void *b, void *ptr)
+{
+	return ldb_collate_cmp(a, b);
+}
+
 /**
  * @brief Checks if two blocks of memory contain the same data, from last to first byte
  * 
@@ -66,40 +79,6 @@ bool ldb_reverse_memcmp(uint8_t *a, uint8_t *b, int bytes)
 	return true;
 }
 
-/**
- * @brief Eliminate duplicated records from data into tmp_data, returns new data size
- * 
- * @param collate pointer to buffer to be collated
- * @param ptr start position
- * @param size block number
- * @return int updated size after collate
- */
-int ldb_eliminate_duplicates(struct ldb_collate_data *collate, long ptr, int size)
-{
-	int new_size = 0;
-	int rec_ln = collate->table_rec_ln;
-	bool skip = false;
-
-	/* Recurse every record in collate->data + ptr */
-	for (long i = 0; i < size; i += collate->table_rec_ln)
-	{
-		uint8_t *a = collate->data + ptr + i;
-		uint8_t *b = collate->tmp_data + new_size;
-
-		/* Check if duplicate */
-		if (new_size) if (ldb_reverse_memcmp(a, b - rec_ln, rec_ln)) skip = true;
-
-		/* Copy record */
-		if (!skip)
-		{
-			memcpy(b, a, rec_ln);
-			new_size += rec_ln;
-		}
-		skip = false;
-	}
-	return new_size;
-}
-
 /**
  * @brief import a list, collate and write to a file.
  * 
@@ -109,12 +88,12 @@ int ldb_eliminate_duplicates(struct ldb_collate_data *collate, long ptr, int siz
 bool ldb_import_list_fixed_records(struct ldb_collate_data *collate)
 {
 	FILE * new_sector = collate->out_sector;
-	int max_per_node = (LDB_MAX_REC_LN - collate->rec_width) / collate->rec_width;
+	int max_per_node = LDB_MAX_FIXED_NODE_LN / collate->rec_width;
 
 	struct ldb_table out_table = collate->out_table;
 	long data_ptr = 0;
 
-	/* Read data in "max_per_node" chunks */
+	/* The list has no duplicates left, write it in full "max_per_node" nodes */
 	while (data_ptr < collate->data_ptr)
 	{
 		int block_size = collate->data_ptr - data_ptr;
@@ -124,15 +103,34 @@ bool ldb_import_list_fixed_records(struct ldb_collate_data *collate)
 		}
 
 		/* Write node */
-		int new_block_size = ldb_eliminate_duplicates(collate, data_ptr, block_size);
-		uint16_t block_records = new_block_size / collate->table_rec_ln;
-		ldb_node_write(out_table, new_sector, collate->last_key, collate->tmp_data, new_block_size, block_records);
+		uint16_t block_records = block_size / collate->table_rec_ln;
+		ldb_node_write(out_table, new_sector, collate->last_key, collate->data + data_ptr, block_size, block_records);
 		data_ptr += block_size;
 	}
 
 	return true;
 }
 
+/**
+ * @brief Writes a node of variable-length records. The buffer starts with the subkey of its first group,
+ * which is handed to ldb_node_write as part of the node key. The node is thus written with the table key
+ * length instead of the 32-bit key of the output table, which packed tables need to front-code subkeys.
+ * @param collate pointer to collate data strcture.
+ * @param node_key buffer for the node key
+ * @param buffer node data
+ * @param buffer_ln node data size
+ */
+void ldb_collate_write_node(struct ldb_collate_data *collate, uint8_t *node_key, uint8_t *buffer, uint32_t buffer_ln)
+{
+	struct ldb_table out_table = collate->out_table;
+	out_table.key_ln = collate->table_key_ln;
+	int subkey_ln = out_table.key_ln - LDB_KEY_LN;
+
+	memcpy(node_key, collate->last_key, LDB_KEY_LN);
+	memcpy(node_key + LDB_KEY_LN, buffer, subkey_ln);
+	ldb_node_write(out_table, collate->out_sector, node_key, buffer + subkey_ln, buffer_ln - subkey_ln, 0);
+}
+
 /**
  * @brief import a list, collate and write to a file.
  * @param collate pointer to collate data strcture.
@@ -140,45 +138,36 @@ bool ldb_import_list_fixed_records(struct ldb_collate_data *collate)
  */
 bool ldb_import_list_variable_records(struct ldb_collate_data *collate)
 {
-	FILE * new_sector = collate->out_sector;
 	uint8_t *buffer = malloc(LDB_MAX_NODE_LN);
 	uint16_t buffer_ptr = 0;
-	uint8_t *rec_key;
+	uint8_t *rec_key = calloc(collate->table_key_ln, 1);
 	uint8_t *last_key = calloc(collate->table_key_ln,1);
+	uint8_t *node_key = calloc(collate->table_key_ln, 1);
 	uint16_t rec_group_start = 0;
 	uint16_t rec_group_size = 0;
 	int subkey_ln = collate->table_key_ln - LDB_KEY_LN;
 	bool new_subkey = true;
 	struct ldb_table out_table = collate->out_table;
 
-	/* Last record checksum to skip duplicates */
-	uint8_t *last_data = calloc(collate->rec_width, 1);
-	uint16_t last_rec_size = 0;
+	/* All records share the list key */
+	memcpy(rec_key, collate->last_key, LDB_KEY_LN);
 
-	for (long data_ptr = 0; data_ptr < collate->data_ptr; data_ptr += collate->rec_width)
+	for (long r = 0; r < collate->list_count; r++)
 	{
-		rec_key = collate->data + data_ptr;
-		uint8_t *data = rec_key + out_table.key_ln + subkey_ln;
-		uint16_t rec_size;
-
-		if (collate->table_rec_ln) rec_size = collate->table_rec_ln;
-		else rec_size = uint32_read(rec_key + collate->rec_width - LDB_KEY_LN);
+		struct ldb_collate_rec *rec = collate->recs + r;
+		memcpy(rec_key + LDB_KEY_LN, collate->data + rec->offset, subkey_ln);
+		uint8_t *data = collate->data + rec->offset + subkey_ln;
+		uint16_t rec_size = rec->size;
 
-		/* If record is duplicated, skip it */
-		if (rec_size == last_rec_size) if (!memcmp(data, last_data, rec_size)) continue;
-
-		/* Update last record */
-		memcpy(last_data, data, rec_size);
-		last_rec_size = rec_size;
-
-		uint32_t projected_size = buffer_ptr + collate->rec_width + (2 * LDB_PTR_LN) + out_table.ts_ln;
+		uint32_t projected_size = buffer_ptr + subkey_ln + 2 + 2 + rec_size + (2 * LDB_PTR_LN) + out_table.ts_ln;
 
 		/* If node size is exceeded, initialize buffer */
 		if (projected_size >= LDB_MAX_REC_LN)
 		{
 			/* Write buffer to disk and initialize buffer */
 			if (rec_group_size > 0) uint16_write(buffer + rec_group_start + subkey_ln, rec_group_size);
-			if (buffer_ptr) ldb_node_write(out_table, new_sector, last_key, buffer, buffer_ptr, 0);
+			if (collate->index) ldb_collate_index_node(collate, last_key);
+			if (buffer_ptr) ldb_collate_write_node(collate, node_key, buffer, buffer_ptr);
 			buffer_ptr = 0;
 			rec_group_start  = 0;
 			rec_group_size   = 0;
@@ -207,6 +196,9 @@ bool ldb_import_list_variable_records(struct ldb_collate_data *collate)
 			/* Update last_key */
 			memcpy(last_key, rec_key, collate->table_key_ln);
 
+			/* Add key to the sector index */
+			if (collate->index) ldb_collate_index_add(collate, rec_key);
+
 			/* Update variables */
 			rec_group_size   = 0;
 		}
@@ -219,15 +211,18 @@ bool ldb_import_list_variable_records(struct ldb_collate_data *collate)
 		memcpy (buffer + buffer_ptr, data, rec_size);
 		buffer_ptr += rec_size;
 		rec_group_size += (2 + rec_size);
+		if (collate->index) ldb_collate_index_count(collate);
 	}
 
 	/* Write buffer to disk */
 	if (rec_group_size > 0) uint16_write(buffer + rec_group_start + subkey_ln, rec_group_size);
-	if (buffer_ptr) ldb_node_write(out_table, new_sector, last_key, buffer, buffer_ptr, 0);
+	if (collate->index) ldb_collate_index_node(collate, last_key);
+	if (buffer_ptr) ldb_collate_write_node(collate, node_key, buffer, buffer_ptr);
 
 	free(buffer);
+	free(rec_key);
 	free(last_key);
-	free(last_data);
+	free(node_key);
 
 	return true;
 }
@@ -239,9 +234,19 @@ bool ldb_import_list_variable_records(struct ldb_collate_data *collate)
  */
 bool ldb_import_list(struct ldb_collate_data *collate)
 {
-	if (collate->table_rec_ln) return ldb_import_list_fixed_records(collate);
+	fseeko64(collate->out_sector, 0, SEEK_END);
+	uint64_t start = ftello64(collate->out_sector);
+	bool out;
 
-	return ldb_import_list_variable_records(collate);
+	if (collate->table_rec_ln) out = ldb_import_list_fixed_records(collate);
+	else out = ldb_import_list_variable_records(collate);
+
+	/* Honour maintenance write and CPU limits */
+	fseeko64(collate->out_sector, 0, SEEK_END);
+	ldb_throttle_write(ftello64(collate->out_sector) - start);
+	ldb_throttle_cpu();
+
+	return out;
 }
 
 /**
@@ -300,21 +305,33 @@ bool ldb_collate_add_variable_record(struct ldb_collate_data *collate, uint8_t *
 	/* Add record exceeds limit, skip it */
 	if (size > collate->max_rec_ln) return false;
 
-	/* Copy main key */
-	memcpy(collate->data + collate->data_ptr, key, LDB_KEY_LN);
-	collate->data_ptr += LDB_KEY_LN;
+	/* Grow the arena and the record array as needed */
+	if (collate->data_ptr + subkey_ln + size > collate->data_size)
+	{
+		while (collate->data_ptr + subkey_ln + size > collate->data_size) collate->data_size *= 2;
+		collate->data = realloc(collate->data, collate->data_size);
+	}
+	if (collate->list_count == collate->recs_size)
+	{
+		collate->recs_size *= 2;
+		collate->recs = realloc(collate->recs, collate->recs_size * sizeof(struct ldb_collate_rec));
+	}
 
-	/* Copy subkey */
+	struct ldb_collate_rec *rec = collate->recs + collate->list_count++;
+	rec->offset = collate->data_ptr;
+	rec->size = size;
+
+	/* Copy subkey and record */
 	memcpy(collate->data + collate->data_ptr, subkey, subkey_ln);
 	collate->data_ptr += subkey_ln;
-
-	/* Copy record */
 	memcpy(collate->data + collate->data_ptr, data, size);
-	collate->data_ptr += collate->max_rec_ln;
+	collate->data_ptr += size;
 
-	/* Copy record length */
-	uint32_write(collate->data + collate->data_ptr, size);
-	collate->data_ptr += 4;
+	/* Leading bytes, for a quick comparison */
+	uint8_t *start = collate->data + rec->offset;
+	uint32_t ln = subkey_ln + size;
+	rec->prefix = 0;
+	for (int i = 0; i < 4; i++) rec->prefix = (rec->prefix << 8) | (i < ln ? start[i] : 0);
 
 	collate->rec_count++;
 	return true;
@@ -340,6 +357,32 @@ bool ldb_collate_add_record(struct ldb_collate_data *collate, uint8_t *key, uint
 	return ldb_collate_add_variable_record(collate, key, subkey, subkey_ln, data, size);
 }
 
+/**
+ * @brief Compare two variable-length records in the collate arena, by subkey and data. Records
+ * sharing their leading bytes are ordered by length.
+ * 
+ * @param a record a
+ * @param b record b
+ * @param ptr pointer to collate data structure
+ * @return 1 if a is bigger than b, -1 if b is bigger tha a, or 0 if they are equals.
+ */
+int ldb_collate_rec_cmp(const void *a, const void *b, void *ptr)
+{
+	const struct ldb_collate_rec *ra = a;
+	const struct ldb_collate_rec *rb = b;
+	struct ldb_collate_data *collate = ptr;
+
+	if (ra->prefix != rb->prefix) return ra->prefix > rb->prefix ? 1 : -1;
+
+	int subkey_ln = collate->table_key_ln - LDB_KEY_LN;
+	uint32_t ln_a = subkey_ln + ra->size;
+	uint32_t ln_b = subkey_ln + rb->size;
+	int cmp = memcmp(collate->data + ra->offset, collate->data + rb->offset, ln_a < ln_b ? ln_a : ln_b);
+	if (cmp) return cmp;
+	if (ln_a != ln_b) return ln_a > ln_b ? 1 : -1;
+	return 0;
+}
+
 /**
  * @brief Sort a list
  * 
@@ -347,25 +390,23 @@ bool ldb_collate_add_record(struct ldb_collate_data *collate, uint8_t *key, uint
  */
 void ldb_collate_sort(struct ldb_collate_data *collate)
 {
-		if (collate->merge) return;
-
-		/* Sort records */
-		size_t items = 0;
-		size_t size = 0;
-		int subkey_ln = collate->table_key_ln - LDB_KEY_LN;
-
-		if (collate->table_rec_ln)
+		/* Variable-length records are sorted through their record array, dropping duplicates
+		   (same subkey and data). Merged lists are not sorted, only consecutive duplicates are dropped */
+		if (!collate->table_rec_ln)
 		{
-			items = collate->data_ptr / (collate->table_rec_ln + subkey_ln);
-			size = collate->table_rec_ln + subkey_ln;
+			size_t size = sizeof(struct ldb_collate_rec);
+			if (collate->merge) collate->list_count = ldb_unique(collate->recs, collate->list_count, size, ldb_collate_rec_cmp, collate);
+			else collate->list_count = ldb_sort_unique(collate->recs, collate->list_count, size, ldb_collate_rec_cmp, collate);
+			return;
 		}
 
-		else
-		{
-			items = collate->data_ptr / collate->rec_width;
-			size = collate->rec_width;
-		}
-		qsort(collate->data, items, size, ldb_collate_cmp);
+		/* Fixed-length records are sorted in place, dropping duplicates across the whole list */
+		int subkey_ln = collate->table_key_ln - LDB_KEY_LN;
+		size_t size = collate->table_rec_ln + subkey_ln;
+		size_t items = collate->data_ptr / size;
+		if (collate->merge) items = ldb_unique(collate->data, items, size, ldb_collate_cmp_r, NULL);
+		else items = ldb_sort_unique(collate->data, items, size, ldb_collate_cmp_r, NULL);
+		collate->data_ptr = items * size;
 }
 
 /**
@@ -420,7 +461,7 @@ bool ldb_collate_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *
 	struct ldb_collate_data *collate = ptr;
 
 	/* If main key has changed, collate and write list and reset data_ptr */
-	if (collate->data_ptr) if (memcmp(key, collate->last_key, LDB_KEY_LN))
+	if (collate->data_ptr || collate->list_count) if (memcmp(key, collate->last_key, LDB_KEY_LN))
 	{
 		/* Sort records */
 		ldb_collate_sort(collate);
@@ -430,10 +471,14 @@ bool ldb_collate_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *
 
 		/* Reset data pointer */
 		collate->data_ptr = 0;
+		collate->list_count = 0;
 	}
 
 	/* If we exceed LDB_MAX_RECORDS, skip it */
-	if ((collate->data_ptr + collate->rec_width) > (LDB_MAX_RECORDS * collate->rec_width))
+	bool list_full = collate->table_rec_ln ?
+			(collate->data_ptr + collate->rec_width) > (LDB_MAX_RECORDS * collate->rec_width) :
+			collate->list_count >= LDB_MAX_RECORDS;
+	if (list_full)
 	{
 		printf("%02x%02x%02x%02x: Max list size exceeded\n", key[0], key[1], key[2], key[3]);
 		return false;
@@ -445,9 +490,21 @@ bool ldb_collate_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *
 		if (key_in_delete_list(collate, key, subkey, subkey_ln)) return false;
 	}
 
+	/* Skip key if found in the delete stream (DELETE with a key file) */
+	else if (collate->del_stream)
+	{
+		if (ldb_delete_stream_match(collate->del_stream, key, subkey, subkey_ln))
+		{
+			collate->del_count++;
+			return false;
+		}
+	}
+
 	/* Keep record */
 	if (ldb_collate_add_record(collate, key, subkey, subkey_ln, data, size))
 	{
+		if (collate->bitmap) ldb_bitmap_add(collate->bitmap, ldb_bitmap_key(key));
+
 		/* Show progress */
 		time_t seconds = time(NULL);
 		if ((seconds - collate->last_report) > COLLATE_REPORT_SEC)
@@ -506,8 +563,9 @@ long *load_del_map(uint8_t *del_keys, long del_ln, int subkey_ln)
  * @param merge True for update a record, false to add a new one.
  * @param del_keys pointer to list of keys to be deleted.
  * @param del_ln number of keys to be deleted
+ * @param del_stream Optional: sorted stream of keys to be deleted, instead of del_keys
  */
-void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec_ln, bool merge, uint8_t *del_keys, long del_ln)
+void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec_ln, bool merge, uint8_t *del_keys, long del_ln, struct ldb_delete_stream *del_stream)
 {
 
 	long *del_map = NULL;
@@ -517,16 +575,63 @@ void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec
 
 	/* Otherwise use the first byte of the first key */
 	if (del_ln) k0 = *del_keys;
+	else if (del_stream) k0 = del_stream->sector;
 
 	long total_records = 0;
 	setlocale(LC_NUMERIC, "");
 
+	/* A full collate records its progress, and resumes an interrupted one */
+	bool checkpoint = !merge && !del_ln && !del_stream;
+	bool done[256] = {false};
+	if (checkpoint)
+	{
+		if (ldb_checkpoint_load(table, done)) printf("Resuming interrupted collate\n");
+		else ldb_checkpoint_start(table);
+		ldb_checkpoint_cleanup(table, done);
+	}
+
+	/* Key presence bitmaps. A full collate rebuilds the bitmap, while a delete only updates an existing one */
+	struct ldb_bitmap *bitmap = NULL;
+	struct ldb_bitmap *out_bitmap = NULL;
+	if (table.bitmap && table.key_ln == LDB_KEY_LN)
+	{
+		bitmap = ldb_bitmap_load(table);
+		if (!bitmap && !del_ln && !del_stream) bitmap = ldb_bitmap_new();
+	}
+	if (!merge) out_bitmap = bitmap;
+	else if (out_table.bitmap && out_table.key_ln == LDB_KEY_LN)
+	{
+		/* Merged keys are added to the destination bitmap at once */
+		out_bitmap = ldb_bitmap_load(out_table);
+		out_table.bitmap = false;
+	}
+
+	/* Repeated record bodies are interned into the dictionary of the output table */
+	if (out_table.intern && !out_table.rec_ln) ldb_dict_writer_open(out_table);
+
 	/* Read each DB sector */
 	do {
+		/* Sectors collated before the interruption keep their keys, taken from their maps */
+		if (done[k0])
+		{
+			if (bitmap) ldb_bitmap_load_sector(table, bitmap, k0);
+			continue;
+		}
+
 		printf("Reading sector %02x\n", k0);
-		uint8_t *sector = ldb_load_sector(table, &k0);
+		time_t started = time(NULL);
+		char sector_path[LDB_MAX_PATH];
+		ldb_checkpoint_sector_path(table, k0, "ldb", sector_path);
+		uint64_t sector_size = ldb_file_exists(sector_path) ? ldb_file_size(sector_path) : 0;
+		struct ldb_sector_load load;
+		uint8_t *sector = ldb_sector_load(table, &k0, ldb_collate_memory(table, max_rec_ln), &load);
+
+		/* Sector keys are added back to the bitmap as they are collated */
+		if (bitmap) ldb_bitmap_clear_sector(bitmap, k0);
 		if (sector)
 		{
+			if (load.mode != LDB_LOAD_FULL) printf("Sector %02x (%'lu bytes) exceeds the memory budget, %s\n", k0, load.size,
+					load.mode == LDB_LOAD_MMAP ? "mapping it" : "streaming it");
 
 			/* Load collate data structure */
 			struct ldb_collate_data collate;
@@ -542,25 +647,41 @@ void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec
 			collate.last_report = 0;
 			collate.merge = merge;
 
+			/* Sorted key index (variable-length records only) */
+			collate.index = table.index && !table.rec_ln && !merge;
+			collate.idx = NULL;
+			collate.idx_count = 0;
+			collate.idx_capacity = 0;
+			collate.idx_pending = 0;
+
+			collate.bitmap = out_bitmap;
+
 			/* Load delete keys map to speed up key lookup */
 			if (del_ln) del_map = load_del_map(del_keys, del_ln, table.key_ln - LDB_KEY_LN);
 			collate.del_keys = del_keys;
 			collate.del_ln = del_ln;
 			collate.del_map = del_map;
+			collate.del_stream = del_stream;
 
+			/* Reserve space for collate data. Variable-length records are packed in an arena which grows
+			   with the list, and sorted through an array of records */
+			collate.list_count = 0;
+			collate.recs = NULL;
 			if (collate.table_rec_ln)
 			{
 				collate.rec_width = collate.table_rec_ln;
+				collate.data_size = LDB_MAX_RECORDS * collate.rec_width;
+				collate.data = calloc(collate.data_size, 1);
 			}
 			else
 			{
-				collate.rec_width = table.key_ln + max_rec_ln + 4;
+				collate.rec_width = 0;
+				collate.data_size = BUFFER_SIZE;
+				collate.data = malloc(collate.data_size);
+				collate.recs_size = 4096;
+				collate.recs = malloc(collate.recs_size * sizeof(struct ldb_collate_rec));
 			}
 
-			/* Reserve space for collate data */
-			collate.data = (char *) calloc(LDB_MAX_RECORDS * collate.rec_width, 1);
-			collate.tmp_data = (char *) calloc(LDB_MAX_RECORDS * collate.rec_width, 1);
-
 			/* Set global cmp width (for qsort) */
 			ldb_cmp_width = max_rec_ln;
 
@@ -571,6 +692,7 @@ void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec
 			uint8_t k[LDB_KEY_LN];
 			k[0] = k0;
 			for (int k1 = 0; k1 < 256; k1++)
+			{
 				for (int k2 = 0; k2 < 256; k2++)
 					for (int k3 = 0; k3 < 256; k3++)
 					{
@@ -584,9 +706,11 @@ void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec
 							ldb_fetch_recordset(sector, table, k, true, ldb_collate_handler, &collate);
 						}
 					}
+				ldb_sector_slice_done(&load);
+			}
 
 			/* Process last record/s */
-			if (collate.data_ptr)
+			if (collate.data_ptr || collate.list_count)
 			{
 				ldb_collate_sort(&collate);
 				ldb_import_list(&collate);
@@ -595,25 +719,47 @@ void ldb_collate(struct ldb_table table, struct ldb_table out_table, int max_rec
 			total_records += collate.rec_count;
 			printf("%'ld records read\n", collate.rec_count);
 
-			/* Close .out sector */
+			/* Close .out sector, its dictionary entries must be on disk before it replaces the sector */
 			fclose(collate.out_sector);
+			ldb_dict_sync();
 
 			/* Move or erase sector */
 			if (collate.merge) ldb_sector_erase(table, k);
 			else ldb_sector_update(out_table, k);
 
+			/* Write sector index */
+			if (collate.index) ldb_index_write(table, k, collate.idx, collate.idx_count);
+			free(collate.idx);
+
+			if (checkpoint) ldb_checkpoint_sector(table, k0, collate.rec_count, sector_size, time(NULL) - started);
+
 			if (collate.del_count) printf("%'ld records deleted\n", collate.del_count);
 
 			free(collate.data);
-			free(collate.tmp_data);
-			free(sector);
+			free(collate.recs);
+			ldb_sector_unload(&load);
 		}
 
 		/* Exit here if it is a delete command, otherwise move to the next sector */
-	} while (k0++ < 255 && !del_ln);
+	} while (k0++ < 255 && !del_ln && !del_stream);
+
+	/* Save key presence bitmaps */
+	if (bitmap)
+	{
+		ldb_bitmap_save(table, bitmap);
+		ldb_bitmap_free(bitmap);
+	}
+	if (merge && out_bitmap)
+	{
+		ldb_bitmap_save(out_table, out_bitmap);
+		ldb_bitmap_free(out_bitmap);
+	}
+
+	ldb_dict_writer_close();
 
 	/* Show processed totals */
 	printf("Collate completed with %'ld records\n", total_records);
+	if (checkpoint) ldb_checkpoint_clear(table);
 
 	fflush(stdout);
 
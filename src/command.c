@@ -218,10 +218,17 @@ void ldb_command_delete(char *command)
 
 	if (ldb_valid_table(dbtable))
 	{
+		/* Apply pending inserts, the lock belongs to another process if they are left pending */
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		if (ldbtable.wal && !ldb_wal_apply(ldbtable))
+		{
+			free(dbtable);
+			return;
+		}
+
 		/* Lock DB */
 		ldb_lock(dbtable);
 		/* Assembly ldb table structure */
-		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
 		struct ldb_table tmptable = ldb_read_cfg(dbtable);
 
 		tmptable.tmp = true;
@@ -230,17 +237,20 @@ void ldb_command_delete(char *command)
 		long keys_ln = 0;
 		uint8_t *keys = fetch_keys(keys_start(command), &keys_ln, ldbtable.key_ln);
 
-		if (ldbtable.key_ln > keys_ln)
+		if (ldbtable.frozen)
+			printf("E080 Table %s is frozen\n", dbtable);
+		else if (ldbtable.key_ln > keys_ln)
 			printf("E076 Keys should contain (%d) bytes and have the first byte in common\n", ldbtable.key_ln);
 		else if (ldbtable.rec_ln && ldbtable.rec_ln != max)
 			printf("E076 Max record length should equal fixed record length (%d)\n", ldbtable.rec_ln);
 		else if (max < ldbtable.key_ln)
 			printf("E076 Max record length cannot be smaller than table key\n");
+		else if (!ldb_collate_memory_check(ldbtable, max));
 		else
 		{
 			qsort(keys, keys_ln / ldbtable.key_ln, ldbtable.key_ln, ldb_collate_cmp);
 			printf("Removing %ld keys\n", keys_ln / ldbtable.key_ln);
-			ldb_collate(ldbtable, tmptable, max, false, keys, keys_ln);
+			ldb_collate(ldbtable, tmptable, max, false, keys, keys_ln, NULL);
 		}
 
 		free(keys);
@@ -253,6 +263,52 @@ void ldb_command_delete(char *command)
 	free(dbtable);
 }
 
+/**
+ * @brief LDB console command to delete the keys in a key file
+ * 
+ * Structure of command:
+ * 
+ * 			delete from DBNAME/TABLENAME max LENGTH keys from PATH
+ * 		      1     2          3         4     5     6    7    8
+ * 
+ * @param command command to be executed
+ */
+void ldb_command_delete_file(char *command)
+{
+	char *dbtable = ldb_extract_word(3, command);
+	char *max_ln  = ldb_extract_word(5, command);
+	char *path = ldb_extract_word(8, command);
+	int max = atoi(max_ln);
+	free(max_ln);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+
+		if (ldbtable.frozen)
+			printf("E080 Table %s is frozen\n", dbtable);
+		else if (ldbtable.rec_ln && ldbtable.rec_ln != max)
+			printf("E076 Max record length should equal fixed record length (%d)\n", ldbtable.rec_ln);
+		else if (max < ldbtable.key_ln)
+			printf("E076 Max record length cannot be smaller than table key\n");
+		else if (!ldb_collate_memory_check(ldbtable, max));
+		else if (!ldb_file_exists(path))
+			printf("E085 Cannot read key file %s\n", path);
+		/* Apply pending inserts */
+		else if (ldbtable.wal && !ldb_wal_apply(ldbtable));
+		else
+		{
+			ldb_lock(dbtable);
+			if (!ldb_delete_file(ldbtable, max, path))
+				printf("E085 Key file should contain %d-byte keys\n", ldbtable.key_ln);
+			ldb_unlock(dbtable);
+		}
+	}
+
+	free(dbtable);
+	free(path);
+}
+
 /**
  * @brief Execute the LDB command collate
  * 
@@ -268,21 +324,31 @@ void ldb_command_collate(char *command)
 
 	if (ldb_valid_table(dbtable))
 	{
+		/* Apply pending inserts, the lock belongs to another process if they are left pending */
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		if (ldbtable.wal && !ldb_wal_apply(ldbtable))
+		{
+			free(dbtable);
+			return;
+		}
+
 		/* Lock DB */
 		ldb_lock(dbtable);
 
 		/* Assembly ldb table structure */
-		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
 		struct ldb_table tmptable = ldb_read_cfg(dbtable);
 		tmptable.tmp = true;
 		tmptable.key_ln = LDB_KEY_LN;
 
-		if (ldbtable.rec_ln && ldbtable.rec_ln != max)
+		if (ldbtable.frozen)
+			printf("E080 Table %s is frozen\n", dbtable);
+		else if (ldbtable.rec_ln && ldbtable.rec_ln != max)
 			printf("E076 Max record length should equal fixed record length (%d)\n", ldbtable.rec_ln);
 		else if (max < ldbtable.key_ln)
 			printf("E076 Max record length cannot be smaller than table key\n");
+		else if (!ldb_collate_memory_check(ldbtable, max));
 		else
-			ldb_collate(ldbtable, tmptable, max, false, NULL, 0);
+			ldb_collate(ldbtable, tmptable, max, false, NULL, 0, NULL);
 	}
 
 	/* Unlock DB */
@@ -292,6 +358,24 @@ void ldb_command_collate(char *command)
 	free(dbtable);
 }
 
+/**
+ * @brief Execute the LDB command collate status
+ * 
+ * @param command input command
+ */
+void ldb_command_collate_status(char *command)
+{
+	char *dbtable = ldb_extract_word(3, command);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		ldb_checkpoint_status(ldbtable);
+	}
+
+	free(dbtable);
+}
+
 /**
  * @brief Execute the LDB command dump
  * 
@@ -342,17 +426,28 @@ void ldb_command_merge(char *command)
 
 	if (ldb_valid_table(dbtable))
 	{		
+		/* Apply pending inserts, the lock belongs to another process if they are left pending */
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		if (ldbtable.wal && !ldb_wal_apply(ldbtable))
+		{
+			free(dbtable);
+			free(totable);
+			return;
+		}
+
 		/* Lock DB */
 		ldb_lock(dbtable);
 
 		/* Assembly ldb table structure */
-		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
 		struct ldb_table outtable = ldb_read_cfg(totable);
 
-		if (ldbtable.rec_ln && ldbtable.rec_ln != max)
+		if (ldbtable.frozen || outtable.frozen)
+			printf("E080 Merge cannot involve frozen tables\n");
+		else if (ldbtable.rec_ln && ldbtable.rec_ln != max)
 			printf("E076 Max record length should equal fixed record length (%d)\n", ldbtable.rec_ln);
 		else if (max < ldbtable.key_ln)
 			printf("E076 Max record length cannot be smaller than table key\n");
+		else if (!ldb_collate_memory_check(ldbtable, max));
 		else if (ldbtable.key_ln != outtable.key_ln)
 			printf("E076 Merge requires tables with equal key length\n");
 		else if (ldbtable.rec_ln != outtable.rec_ln)
@@ -361,7 +456,7 @@ void ldb_command_merge(char *command)
 		{
 			outtable.tmp = false;
 			outtable.key_ln = LDB_KEY_LN;
-			ldb_collate(ldbtable, outtable, max, true, NULL, 0);
+			ldb_collate(ldbtable, outtable, max, true, NULL, 0, NULL);
 		}
 	}
 
@@ -405,11 +500,23 @@ void ldb_command_unlink_list(char *command)
 			/* Assembly ldb table structure */
 			struct ldb_table ldbtable = ldb_read_cfg(dbtable);
 
-			/* Open sector, wipe list pointer and close */
-			FILE *sector;
-			sector = ldb_open(ldbtable, keybin, "r+");
-			ldb_list_unlink(sector, keybin);
-			fclose(sector);
+			if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
+
+			/* Apply pending inserts, which could otherwise relink the list */
+			else if (ldbtable.wal && !ldb_wal_apply(ldbtable));
+			else
+			{
+				/* Unlinking does not change the sector size, drop its index */
+				if (ldbtable.index) ldb_index_drop(ldbtable, keybin);
+
+				/* Open sector, wipe list pointer and close */
+				FILE *sector;
+				sector = ldb_open(ldbtable, keybin, "r+");
+				ldb_list_unlink(sector, keybin);
+				fclose(sector);
+
+				ldb_bitmap_log(ldbtable, keybin, false);
+			}
 		}
 	}
 
@@ -461,16 +568,31 @@ void ldb_command_insert(char *command, commandtype type)
 			/* Assembly ldb table structure */
 			struct ldb_table ldbtable = ldb_read_cfg(dbtable);
 
-			/* Write record into ldb table */
-			FILE *sector;
-			sector = ldb_open(ldbtable, keybin, "r+");
+			/* Frozen tables are read-only */
+			if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
 
-			if (type == INSERT_HEX) 
-				ldb_node_write(ldbtable, sector, keybin, databin, dataln, 0); // TODO, this 0 must come from cfg
+			/* Append record to the write-ahead log, if enabled for the table */
+			else if (ldbtable.wal)
+			{
+				if (type == INSERT_HEX)
+					ldb_wal_append(ldbtable, keybin, databin, dataln, 0);
+				else
+					ldb_wal_append(ldbtable, keybin, (uint8_t *) data, dataln, 0);
+			}
+
+			/* Otherwise write record into ldb table */
 			else
-				ldb_node_write(ldbtable, sector, keybin, (uint8_t *) data, dataln, 0); // TODO Ditto
+			{
+				FILE *sector;
+				sector = ldb_open(ldbtable, keybin, "r+");
+
+				if (type == INSERT_HEX) 
+					ldb_node_write(ldbtable, sector, keybin, databin, dataln, 0); // TODO, this 0 must come from cfg
+				else
+					ldb_node_write(ldbtable, sector, keybin, (uint8_t *) data, dataln, 0); // TODO Ditto
 
-			fclose(sector);
+				fclose(sector);
+			}
 		}
 	}
 
@@ -482,6 +604,492 @@ void ldb_command_insert(char *command, commandtype type)
 	free(databin);
 }
 
+/**
+ * @brief Checks if a table has any sector
+ * 
+ * @param table table struct config
+ * @return true if a sector exists
+ */
+bool ldb_table_has_sectors(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	for (int i = 0; i < 256; i++)
+	{
+		ldb_checkpoint_sector_path(table, i, "ldb", path);
+		if (ldb_file_exists(path)) return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Execute LDB command alter table, which enables or disables a table option
+ * 
+ * Structure of the command:
+ * 
+ * 		alter table DBNAME/TABLENAME set|unset OPTION
+ * 	      1     2         3              4       5
+ * 
+ * @param command command string
+ * @param enable true to set the option, false to unset it
+ */
+void ldb_command_alter_table(char *command, bool enable)
+{
+	char *dbtable = ldb_extract_word(3, command);
+	char *option = ldb_extract_word(5, command);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+
+		bool compress = ldbtable.compress;
+		bool frontcode = ldbtable.frontcode;
+		bool intern = ldbtable.intern;
+
+		/* Frozen sectors are made by freeze, and cannot be switched on or off */
+		if (!strcmp(option, "frozen")) printf("E078 Option frozen is set by freeze only\n");
+
+		/* Inserts logged so far must reach the sectors before the log is abandoned */
+		else if (!enable && ldbtable.wal && !strcmp(option, "wal") && !ldb_wal_apply(ldbtable));
+
+		else if (!ldb_set_cfg_option(&ldbtable, option, strlen(option), enable))
+			printf("E078 Unknown table option %s\n", option);
+
+		/* Existing nodes would not match the new format */
+		else if ((ldbtable.compress || ldbtable.frontcode || ldbtable.intern) && ldbtable.rec_ln)
+			printf("E088 Option %s requires variable-length records\n", option);
+		else if ((ldbtable.compress != compress || ldbtable.frontcode != frontcode || ldbtable.intern != intern) && ldb_table_has_sectors(ldbtable))
+			printf("E088 Table %s is not empty, merge it into a new table with %s set instead\n", dbtable, option);
+		else
+		{
+			ldb_update_cfg(ldbtable);
+			printf("OK\n");
+		}
+	}
+
+	free(dbtable);
+	free(option);
+}
+
+/**
+ * @brief Execute LDB command set, which changes a global option in ldb.cfg. Running maintenance
+ * tasks pick up the change within a second.
+ * 
+ * Structure of the command:
+ * 
+ * 		set OPTION=VALUE
+ * 	     1        2
+ * 
+ * @param command command string
+ */
+void ldb_command_set(char *command)
+{
+	char *option = ldb_extract_word(2, command);
+
+	struct ldb_global_cfg cfg;
+	ldb_read_global_cfg(&cfg);
+
+	if (!ldb_set_global_option(&cfg, option)) printf("E086 Invalid setting %s\n", option);
+	else
+	{
+		ldb_write_global_cfg(cfg);
+		printf("OK\n");
+	}
+
+	free(option);
+}
+
+/**
+ * @brief Execute LDB command show settings, listing the global options (0 for no limit)
+ */
+void ldb_command_show_settings()
+{
+	struct ldb_global_cfg cfg;
+	ldb_read_global_cfg(&cfg);
+
+	printf("read_mbps=%ld\n", cfg.read_mbps);
+	printf("write_mbps=%ld\n", cfg.write_mbps);
+	printf("cpu_share=%ld\n", cfg.cpu_share);
+	printf("memory_mb=%ld\n", cfg.memory_mb);
+}
+
+/**
+ * @brief Execute LDB command wal replay, applying pending inserts into the table sectors
+ * 
+ * @param command command string
+ */
+void ldb_command_wal_replay(char *command)
+{
+	char *dbtable = ldb_extract_word(3, command);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		ldb_wal_apply(ldbtable);
+	}
+
+	free(dbtable);
+}
+
+/**
+ * @brief Execute LDB command freeze, converting the table into immutable, read-optimised sectors
+ * 
+ * @param command command string
+ */
+void ldb_command_freeze(char *command)
+{
+	char *dbtable = ldb_extract_word(2, command);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+
+		if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
+		/* Pending inserts must make it into the frozen sectors */
+		else if (ldbtable.wal && !ldb_wal_apply(ldbtable));
+		else
+		{
+			ldb_lock(dbtable);
+			ldb_freeze(ldbtable);
+			ldb_unlock(dbtable);
+		}
+	}
+
+	free(dbtable);
+}
+
+/**
+ * @brief Execute LDB command vacuum, reclaiming unlinked and deleted nodes
+ * 
+ * @param command command string
+ */
+void ldb_command_vacuum(char *command)
+{
+	char *dbtable = ldb_extract_word(2, command);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+
+		if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
+		/* Apply pending inserts, which could otherwise relink the lists */
+		else if (ldbtable.wal && !ldb_wal_apply(ldbtable));
+		else
+		{
+			ldb_lock(dbtable);
+			ldb_vacuum(ldbtable);
+			ldb_unlock(dbtable);
+		}
+	}
+
+	free(dbtable);
+}
+
+/**
+ * @brief Execute LDB command unlink keys, unlinking the records for all the keys in a key file
+ * 
+ * Structure of command:
+ * 
+ * 			unlink keys from DBNAME/TABLENAME file PATH
+ * 		      1     2    3          4          5    6
+ * 
+ * @param command command string
+ */
+void ldb_command_unlink_keys(char *command)
+{
+	char *dbtable = ldb_extract_word(4, command);
+	char *path = ldb_extract_word(6, command);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		uint64_t count = 0;
+		uint8_t *keys = ldb_load_key_file(path, ldbtable.key_ln, &count);
+
+		if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
+		else if (!keys) printf("E085 Key file should contain %d-byte keys\n", ldbtable.key_ln);
+		else if (ldb_node_packed(ldbtable) && ldbtable.key_ln > LDB_KEY_LN)
+			printf("E088 Subkeys cannot be unlinked from packed table %s, use delete instead\n", dbtable);
+		/* Apply pending inserts, which could otherwise relink the lists */
+		else if (ldbtable.wal && !ldb_wal_apply(ldbtable));
+		else
+		{
+			ldb_lock(dbtable);
+			uint64_t unlinked = ldb_unlink_keys(ldbtable, keys, count);
+			ldb_unlock(dbtable);
+
+			printf("%'lu keys read, %'lu lists or record groups unlinked\n", count, unlinked);
+		}
+		free(keys);
+	}
+
+	free(dbtable);
+	free(path);
+}
+
+/**
+ * @brief Execute LDB command count, showing the number of records for one or more keys as KEY,COUNT
+ * 
+ * @param command command string
+ * @param type COUNT (one key) or COUNT_KEYS (comma separated key list)
+ */
+void ldb_command_count(char *command, commandtype type)
+{
+	char *dbtable = ldb_extract_word(3, command);
+	char *keys = NULL;
+
+	if (type == COUNT) keys = ldb_extract_word(5, command);
+	else keys = strdup(keys_start(command));
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+
+		/* All keys must be either 32-bit or full table keys */
+		int hex_ln = strcspn(keys, ", ");
+		int key_ln = hex_ln / 2;
+		long count = 0;
+		uint8_t *keybin = NULL;
+
+		if ((key_ln != ldbtable.key_ln && key_ln != LDB_KEY_LN) || hex_ln % 2)
+			printf("E073 Provided key length is invalid\n");
+		else
+		{
+			keybin = malloc(strlen(keys) / 2 + 1);
+			char *key = keys;
+			while (*key)
+			{
+				if (*key == ' ' || *key == ',') key++;
+				else if (strcspn(key, ", ") == hex_ln && valid_hex_ln(key, hex_ln))
+				{
+					ldb_hex_to_bin(key, hex_ln, keybin + count * key_ln);
+					count++;
+					key += hex_ln;
+				}
+				else
+				{
+					printf("E073 Provided key length is invalid\n");
+					count = 0;
+					break;
+				}
+			}
+		}
+
+		if (count)
+		{
+			uint32_t *records = malloc(count * sizeof(uint32_t));
+			ldb_count_records_batch(ldbtable, keybin, key_ln, count, records);
+
+			for (long i = 0; i < count; i++)
+			{
+				for (int j = 0; j < key_ln; j++) printf("%02x", keybin[i * key_ln + j]);
+				printf(",%u\n", records[i]);
+			}
+			free(records);
+		}
+		free(keybin);
+	}
+
+	free(dbtable);
+	free(keys);
+}
+
+/**
+ * @brief Prints a record as ASCII, replacing non printable characters with dots
+ * 
+ * @param data record
+ * @param size record length
+ */
+void ldb_print_ascii_field(uint8_t *data, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+		if (data[i] >= 32 && data[i] <= 126)
+			fwrite(data + i, 1, 1, stdout);
+		else
+			fwrite(".", 1, 1, stdout);
+}
+
+/**
+ * @brief Handler function for the join command. Prints KEY_A,RECORD_A,KEY_B,RECORD_B
+ * 
+ * @param a_key key of table A
+ * @param a_data record of table A
+ * @param a_size record length
+ * @param b_key key of table B
+ * @param b_key_ln key length
+ * @param b_data record of table B
+ * @param b_size record length
+ * @param ptr pointer to the key length of table A
+ * @return false always
+ */
+bool ldb_join_print(uint8_t *a_key, uint8_t *a_data, uint32_t a_size, uint8_t *b_key, int b_key_ln, uint8_t *b_data, uint32_t b_size, void *ptr)
+{
+	int *a_key_ln = ptr;
+	for (int i = 0; i < *a_key_ln; i++) printf("%02x", a_key[i]);
+	printf(",");
+	ldb_print_ascii_field(a_data, a_size);
+	printf(",");
+	for (int i = 0; i < b_key_ln; i++) printf("%02x", b_key[i]);
+	printf(",");
+	ldb_print_ascii_field(b_data, b_size);
+	printf("\n");
+	return false;
+}
+
+/**
+ * @brief Execute LDB command join
+ * 
+ * Structure of the command:
+ * 
+ * 		join DBNAME/TABLE_A key KEY field|bytes N with DBNAME/TABLE_B [threads N]
+ * 		 1        2          3   4       5       6  7         8          9     10
+ * 
+ * @param command command string
+ * @param type JOIN_FIELD or JOIN_BYTES
+ */
+void ldb_command_join(char *command, commandtype type)
+{
+	char *a_table = ldb_extract_word(2, command);
+	char *key = ldb_extract_word(4, command);
+	char *position = ldb_extract_word(6, command);
+	char *b_table = ldb_extract_word(8, command);
+	char *threads_word = ldb_extract_word(9, command);
+	char *threads_nr = ldb_extract_word(10, command);
+
+	int threads = LDB_JOIN_THREADS;
+	bool valid_threads = true;
+	if (!strcmp(threads_word, "threads"))
+	{
+		valid_threads = (*threads_nr && strspn(threads_nr, "0123456789") == strlen(threads_nr));
+		threads = atoi(threads_nr);
+	}
+
+	bool valid_position = (*position && strspn(position, "0123456789") == strlen(position));
+	int pos = atoi(position);
+	if (type == JOIN_FIELD && !pos) valid_position = false;
+
+	if (!valid_position || !valid_threads) printf("E066 Syntax error\n");
+
+	else if (ldb_valid_table(a_table) && ldb_valid_table(b_table))
+	{
+		struct ldb_table a = ldb_read_cfg(a_table);
+		struct ldb_table b = ldb_read_cfg(b_table);
+		int key_ln = strlen(key) / 2;
+
+		if (strlen(key) < 8) printf("E071 Key length cannot be less than 32 bits\n");
+		else if ((key_ln != a.key_ln) && (key_ln != LDB_KEY_LN)) printf("E073 Provided key length is invalid\n");
+		else
+		{
+			uint8_t keybin[256];
+			ldb_hex_to_bin(key, strlen(key), keybin);
+
+			if (type == JOIN_FIELD)
+				ldb_join_records(a, keybin, key_ln == LDB_KEY_LN, b, b.key_ln, pos, 0, threads, ldb_join_print, &key_ln);
+			else
+				ldb_join_records(a, keybin, key_ln == LDB_KEY_LN, b, b.key_ln, 0, pos, threads, ldb_join_print, &key_ln);
+		}
+	}
+
+	free(a_table);
+	free(key);
+	free(position);
+	free(b_table);
+	free(threads_word);
+	free(threads_nr);
+}
+
+/**
+ * @brief Execute LDB command sample, showing N random records from a table or key
+ * 
+ * @param command command string
+ * @param type SAMPLE_KEY or SAMPLE (whole table)
+ */
+void ldb_command_sample(char *command, commandtype type)
+{
+	char *count = ldb_extract_word(2, command);
+	char *dbtable = ldb_extract_word(4, command);
+	char *key = (type == SAMPLE_KEY) ? ldb_extract_word(6, command) : NULL;
+
+	if (!*count || strspn(count, "0123456789") != strlen(count)) printf("E066 Syntax error\n");
+
+	else if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		uint8_t keybin[256];
+		int key_ln = key ? strlen(key) / 2 : LDB_KEY_LN;
+		int width = ldbtable.rec_ln;
+
+		if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
+		else if (key && strlen(key) < 8) printf("E071 Key length cannot be less than 32 bits\n");
+		else if (key && (key_ln != ldbtable.key_ln) && (key_ln != LDB_KEY_LN)) printf("E073 Provided key length is invalid\n");
+		else
+		{
+			if (key) ldb_hex_to_bin(key, strlen(key), keybin);
+
+			if (ldbtable.rec_ln)
+				ldb_sample(ldbtable, key ? keybin : NULL, key_ln == LDB_KEY_LN, atoi(count), ldb_hexprint_width, &width);
+			else
+				ldb_sample(ldbtable, key ? keybin : NULL, key_ln == LDB_KEY_LN, atoi(count), ldb_asciiprint, NULL);
+		}
+	}
+
+	free(count);
+	free(dbtable);
+	free(key);
+}
+
+/**
+ * @brief Execute LDB command update, overwriting fixed-length records in place
+ * 
+ * Structure of command:
+ * 
+ * 			update DBNAME/TABLENAME key KEY match N hex RECORD
+ * 		      1          2          3   4    5   6  7    8
+ * 
+ * @param command command string
+ */
+void ldb_command_update(char *command)
+{
+	/* Extract values from command */
+	char *dbtable = ldb_extract_word(2, command);
+	char *key = ldb_extract_word(4, command);
+	char *match = ldb_extract_word(6, command);
+	char *data = ldb_extract_word(8, command);
+	int match_ln = atoi(match);
+
+	if (ldb_valid_table(dbtable))
+	{
+		struct ldb_table ldbtable = ldb_read_cfg(dbtable);
+		int key_ln = strlen(key) / 2;
+
+		if (ldbtable.frozen) printf("E080 Table %s is frozen\n", dbtable);
+		else if (!ldbtable.rec_ln) printf("E084 Update requires a table with fixed-length records\n");
+		else if (key_ln != ldbtable.key_ln) printf("E073 Provided key length is invalid\n");
+		else if (strlen(data) != ldbtable.rec_ln * 2) printf("E084 Record should contain (%d) bytes\n", ldbtable.rec_ln);
+		else if (match_ln < 1 || match_ln > ldbtable.rec_ln) printf("E084 Match length should be between 1 and %d\n", ldbtable.rec_ln);
+		/* Apply pending inserts, so that they can be updated too */
+		else if (ldbtable.wal && !ldb_wal_apply(ldbtable));
+		else
+		{
+			uint8_t keybin[256];
+			uint8_t *record = malloc(ldbtable.rec_ln);
+			ldb_hex_to_bin(key, strlen(key), keybin);
+			ldb_hex_to_bin(data, strlen(data), record);
+
+			ldb_lock(dbtable);
+			int updated = ldb_node_update(ldbtable, keybin, record, match_ln);
+			ldb_unlock(dbtable);
+
+			printf("Updated %d records\n", updated);
+			free(record);
+		}
+	}
+
+	free(dbtable);
+	free(key);
+	free(match);
+	free(data);
+}
+
 /**
  * @brief LDB command create new table
  * The command is of the form: 
@@ -512,6 +1120,214 @@ void ldb_command_create_table(char *command)
 	free(dbtable);
 }
 
+/**
+ * @brief Parses the optional "limit N" and "offset M" clauses at the end of a select command
+ * 
+ * @param command command string
+ * @param limit[out] limit (0 if not given)
+ * @param offset[out] offset (0 if not given)
+ * @return false if a value is not a valid number
+ */
+bool ldb_command_select_range(char *command, uint32_t *limit, uint32_t *offset)
+{
+	bool valid = true;
+	int words = ldb_word_count(command);
+
+	for (int i = 6; i < words && valid; i++)
+	{
+		char *word = ldb_extract_word(i, command);
+		uint32_t *target = NULL;
+		if (!strcmp(word, "where")) i += 4;
+		else if (!strcmp(word, "limit")) target = limit;
+		else if (!strcmp(word, "offset")) target = offset;
+
+		if (target)
+		{
+			char *value = ldb_extract_word(++i, command);
+			valid = (*value && strspn(value, "0123456789") == strlen(value));
+			if (valid) *target = strtoul(value, NULL, 10);
+			free(value);
+		}
+		free(word);
+	}
+	return valid;
+}
+
+/**
+ * @brief Parses the optional filter clause of a select command, which is either
+ * "where bytes N equals HEX" (record bytes from position N) or "where field N equals|starts VALUE" (CSV field N)
+ * 
+ * @param command command string
+ * @param filter[out] filter
+ * @return 1 if there is a valid filter, 0 if there is no filter, -1 if the filter is not valid
+ */
+int ldb_command_select_filter(char *command, struct ldb_filter *filter)
+{
+	int out = 0;
+	int words = ldb_word_count(command);
+
+	for (int i = 6; i < words && !out; i++)
+	{
+		char *word = ldb_extract_word(i, command);
+		if (!strcmp(word, "where"))
+		{
+			char *target = ldb_extract_word(i + 1, command);
+			char *position = ldb_extract_word(i + 2, command);
+			char *operator = ldb_extract_word(i + 3, command);
+			char *value = ldb_extract_word(i + 4, command);
+			int value_ln = strlen(value);
+			out = -1;
+
+			memset(filter, 0, sizeof(struct ldb_filter));
+			filter->position = atoi(position);
+			bool valid_position = (*position && strspn(position, "0123456789") == strlen(position));
+
+			if (!strcmp(target, "bytes") && !strcmp(operator, "equals") && valid_position)
+			{
+				if (value_ln && !(value_ln % 2) && value_ln / 2 <= LDB_MAX_FILTER_LN && valid_hex_ln(value, value_ln))
+				{
+					filter->type = LDB_FILTER_BYTES;
+					filter->value_ln = value_ln / 2;
+					ldb_hex_to_bin(value, value_ln, filter->value);
+					out = 1;
+				}
+			}
+			else if (!strcmp(target, "field") && valid_position && filter->position && value_ln <= LDB_MAX_FILTER_LN)
+			{
+				if (!strcmp(operator, "equals")) filter->type = LDB_FILTER_FIELD_EQUALS;
+				else if (!strcmp(operator, "starts")) filter->type = LDB_FILTER_FIELD_STARTS;
+				else value_ln = -1;
+
+				if (value_ln >= 0)
+				{
+					filter->value_ln = value_ln;
+					memcpy(filter->value, value, value_ln);
+					out = 1;
+				}
+			}
+
+			free(target);
+			free(position);
+			free(operator);
+			free(value);
+		}
+		free(word);
+	}
+	return out;
+}
+
+/**
+ * @brief Handler function for multi-table selects. Prints the table name as the first field, then
+ * passes the record to the select output handler
+ * 
+ * @param key key
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @param data record
+ * @param size record length
+ * @param iteration iteration number
+ * @param ptr pointer to the ldb_select_tag of the table
+ * @return value returned by the output handler
+ */
+bool ldb_tagged_print(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr)
+{
+	struct ldb_select_tag *tag = ptr;
+	printf("%s,", tag->table);
+	return tag->handler(key, subkey, subkey_ln, data, size, iteration, tag->ptr);
+}
+
+/**
+ * @brief Execute LDB command select on a comma separated list of tables. Tables are read concurrently
+ * and records are printed table by table, with the table name as the first field.
+ * 
+ * @param dbtables comma separated list of db/table
+ * @param key hex key
+ * @param format format type
+ * @param hex_bytes number of hex bytes (CSV format)
+ * @param filter Optional: record filter
+ * @param offset number of records to skip in each table
+ * @param limit maximum number of records per table (0 for no limit)
+ */
+void ldb_command_select_multi(char *dbtables, char *key, select_format format, int hex_bytes, struct ldb_filter *filter, uint32_t offset, uint32_t limit)
+{
+	struct ldb_table tables[LDB_MAX_MULTI];
+	struct ldb_select_tag tags[LDB_MAX_MULTI];
+	void *ptrs[LDB_MAX_MULTI];
+	int table_count = 0;
+	bool valid = true;
+
+	uint8_t keybin[256];
+	int key_ln = (int) strlen(key) / 2;
+	if (strlen(key) < 8) 
+	{
+		printf("E071 Key length cannot be less than 32 bits\n");
+		return;
+	}
+	if (key_ln > sizeof(keybin))
+	{
+		printf("E073 Provided key length is invalid\n");
+		return;
+	}
+	ldb_hex_to_bin(key, strlen(key), keybin);
+
+	/* Read table list */
+	char *dbtable = dbtables;
+	while (*dbtable && valid)
+	{
+		int ln = strcspn(dbtable, ",");
+		if (ln && ln < LDB_MAX_PATH)
+		{
+			if (table_count == LDB_MAX_MULTI)
+			{
+				printf("E083 Too many tables (max %d)\n", LDB_MAX_MULTI);
+				valid = false;
+				break;
+			}
+
+			struct ldb_select_tag *tag = tags + table_count;
+			memset(tag, 0, sizeof(struct ldb_select_tag));
+			memcpy(tag->table, dbtable, ln);
+			valid = ldb_valid_table(tag->table);
+			if (!valid) break;
+
+			struct ldb_table *table = tables + table_count;
+			*table = ldb_read_cfg(tag->table);
+			if ((key_ln != table->key_ln) && (key_ln != LDB_KEY_LN))
+			{
+				printf("E073 Provided key length is invalid\n");
+				valid = false;
+				break;
+			}
+
+			/* Output handler for the table */
+			switch (format)
+			{
+				case HEX:
+					tag->width = table->rec_ln ? table->rec_ln : 16;
+					tag->handler = ldb_hexprint_width;
+					tag->ptr = &tag->width;
+					break;
+
+				case ASCII:
+					tag->handler = ldb_asciiprint;
+					break;
+
+				case CSV:
+					tag->width = hex_bytes;
+					tag->handler = ldb_csvprint;
+					tag->ptr = &tag->width;
+					break;
+			}
+			ptrs[table_count++] = tag;
+		}
+		dbtable += ln;
+		if (*dbtable) dbtable++;
+	}
+
+	if (valid && table_count)
+		ldb_fetch_recordset_multi(tables, table_count, keybin, (key_ln == 4), filter, offset, limit, ldb_tagged_print, ptrs);
+}
+
 /**
  * @brief Execute LDB command select
  * 
@@ -535,7 +1351,24 @@ void ldb_command_select(char *command, select_format format)
 		if (hexbytes) hex_bytes = atoi(hexbytes);
 	}
 
-	if (ldb_valid_table(dbtable))
+	/* Optional limit N and offset M */
+	uint32_t limit = 0;
+	uint32_t offset = 0;
+	bool valid_range = ldb_command_select_range(command, &limit, &offset);
+
+	/* Optional filter */
+	struct ldb_filter filter;
+	int filtered = ldb_command_select_filter(command, &filter);
+	struct ldb_filter *where = (filtered > 0) ? &filter : NULL;
+
+	if (!valid_range) printf("E081 Invalid limit or offset\n");
+
+	else if (filtered < 0) printf("E082 Invalid filter\n");
+
+	/* Multi-table select */
+	else if (strchr(dbtable, ',')) ldb_command_select_multi(dbtable, key, format, hex_bytes, where, offset, limit);
+
+	else if (ldb_valid_table(dbtable))
 	{
 		/* Validate key */
 		if (strlen(key) < 8) printf("E071 Key length cannot be less than 32 bits\n");
@@ -562,15 +1395,15 @@ void ldb_command_select(char *command, select_format format)
 				switch (format)
 				{
 					case HEX:
-						ldb_fetch_recordset(NULL, ldbtable, keybin, (key_ln == 4), ldb_hexprint_width, &width);
+						ldb_fetch_recordset_filter(NULL, ldbtable, keybin, (key_ln == 4), where, offset, limit, ldb_hexprint_width, &width);
 						break;
 
 					case ASCII:
-						ldb_fetch_recordset(NULL, ldbtable, keybin, (key_ln == 4), ldb_asciiprint, NULL);
+						ldb_fetch_recordset_filter(NULL, ldbtable, keybin, (key_ln == 4), where, offset, limit, ldb_asciiprint, NULL);
 						break;
 
 					case CSV:
-						ldb_fetch_recordset(NULL, ldbtable, keybin, (key_ln == 4), ldb_csvprint, &hex_bytes);
+						ldb_fetch_recordset_filter(NULL, ldbtable, keybin, (key_ln == 4), where, offset, limit, ldb_csvprint, &hex_bytes);
 						break;
 				}
 			}
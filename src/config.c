@@ -72,6 +72,63 @@ bool ldb_load_cfg(char *db, char *table, struct ldb_recordset *rs)
 	return true;
 }
 
+/**
+ * @brief Enables or disables a table option by name
+ * 
+ * @param table pointer to table struct to be updated
+ * @param option option name (not null terminated)
+ * @param ln length of the option name
+ * @param enable true to enable the option, false to disable it
+ * @return true if the option is known
+ */
+bool ldb_set_cfg_option(struct ldb_table *table, char *option, int ln, bool enable)
+{
+	if (ln == 3 && !memcmp(option, "wal", 3)) table->wal = enable;
+	else if (ln == 5 && !memcmp(option, "index", 5)) table->index = enable;
+	else if (ln == 6 && !memcmp(option, "bitmap", 6)) table->bitmap = enable;
+	else if (ln == 8 && !memcmp(option, "compress", 8)) table->compress = enable;
+	else if (ln == 9 && !memcmp(option, "frontcode", 9)) table->frontcode = enable;
+	else if (ln == 6 && !memcmp(option, "intern", 6)) table->intern = enable;
+	else if (ln == 5 && !memcmp(option, "dedup", 5)) table->merge = enable ? LDB_MERGE_DEDUP : LDB_MERGE_ALL;
+
+	/* upsert=N sets last-writer-wins on key field N */
+	else if (ln >= 6 && !memcmp(option, "upsert", 6))
+	{
+		if (!enable) table->merge = LDB_MERGE_ALL;
+		else
+		{
+			if (ln < 8 || option[6] != '=') return false;
+			int field = atoi(option + 7);
+			if (field < 1) return false;
+			table->merge = LDB_MERGE_LAST;
+			table->merge_field = field;
+		}
+	}
+	else return false;
+	return true;
+}
+
+/**
+ * @brief Parses the comma separated table options that follow keylen and reclen in the .cfg file
+ * 
+ * @param table pointer to table struct to be updated
+ * @param options string with the options
+ */
+void ldb_parse_cfg_options(struct ldb_table *table, char *options)
+{
+	while (*options)
+	{
+		int ln = strcspn(options, ", \r\n");
+
+		/* frozen is only set by ldb_freeze, it cannot be altered */
+		if (ln == 6 && !memcmp(options, "frozen", 6)) table->frozen = true;
+		else if (ln) if (!ldb_set_cfg_option(table, options, ln, true))
+			printf("Warning: unknown option %.*s in %s/%s.cfg\n", ln, options, table->db, table->table);
+		options += ln;
+		if (*options) options++;
+	}
+}
+
 /**
  * @brief Read table config from a file and loads insto a ldb_table structure
  * 
@@ -88,16 +145,15 @@ struct ldb_table ldb_read_cfg(char *db_table)
 	FILE *cfg = fopen(path, "r");
 	free(path);
 
-	memcpy(tablecfg.db,   "\0", 1);
-	memcpy(tablecfg.table, "\0", 1);
-	tablecfg.tmp = false;
+	memset(&tablecfg, 0, sizeof(tablecfg));
 
 	if (cfg != NULL) {
 
 		// Read configuration file
-		char *buffer = calloc(LDB_MAX_NAME, 1);
-		if (!fread(buffer, 1, LDB_MAX_NAME, cfg)) printf("Warning: cannot read file %s\n", path);
+		char *buffer = calloc(LDB_MAX_PATH, 1);
+		if (!fread(buffer, 1, LDB_MAX_PATH - 1, cfg)) printf("Warning: cannot read file %s\n", db_table);
 		char *reclen = buffer + ldb_split_string(buffer, ',');
+		char *options = reclen + ldb_split_string(reclen, ',');
 
 		// Assign values to cfg structure
 		char tmp[LDB_MAX_PATH] = "\0";
@@ -108,8 +164,12 @@ struct ldb_table ldb_read_cfg(char *db_table)
 		tablecfg.key_ln = atoi(buffer);
 		tablecfg.rec_ln = atoi(reclen);
 		tablecfg.ts_ln = 2;
+		if (options < buffer + LDB_MAX_PATH) ldb_parse_cfg_options(&tablecfg, options);
 		fclose(cfg);
 		free(buffer);
+
+		/* Repair a log left behind by a crash before the table is used */
+		if (tablecfg.wal) ldb_wal_recover_table(tablecfg);
 	}
 
 	return tablecfg;
@@ -135,3 +195,104 @@ void ldb_write_cfg(char *db, char *table, int keylen, int reclen)
 	free(path);
 }
 
+/**
+ * @brief Save table config, including table options, into its .cfg file
+ * 
+ * @param table table struct to be saved
+ */
+void ldb_update_cfg(struct ldb_table table)
+{
+	char *path = malloc(LDB_MAX_PATH);
+	sprintf(path, "%s/%s/%s.cfg", ldb_root, table.db, table.table);
+
+	FILE *cfg = fopen(path, "w");
+	if (!cfg) ldb_error("E065 Cannot write table configuration");
+
+	fprintf(cfg, "%d,%d", table.key_ln, table.rec_ln);
+	if (table.wal) fprintf(cfg, ",wal");
+	if (table.frozen) fprintf(cfg, ",frozen");
+	if (table.index) fprintf(cfg, ",index");
+	if (table.bitmap) fprintf(cfg, ",bitmap");
+	if (table.compress) fprintf(cfg, ",compress");
+	if (table.frontcode) fprintf(cfg, ",frontcode");
+	if (table.intern) fprintf(cfg, ",intern");
+	if (table.merge == LDB_MERGE_DEDUP) fprintf(cfg, ",dedup");
+	if (table.merge == LDB_MERGE_LAST) fprintf(cfg, ",upsert=%d", table.merge_field);
+	fprintf(cfg, "\n");
+	fclose(cfg);
+
+	free(path);
+}
+
+/**
+ * @brief Sets a global option from a NAME=VALUE string
+ * 
+ * @param cfg pointer to global options to be updated
+ * @param option option string
+ * @return true if the option is known and the value is valid
+ */
+bool ldb_set_global_option(struct ldb_global_cfg *cfg, char *option)
+{
+	char *value = strchr(option, '=');
+	if (!value || !isdigit(value[1])) return false;
+	int ln = value - option;
+	long n = atol(++value);
+
+	if (ln == 9 && !memcmp(option, "read_mbps", 9)) cfg->read_mbps = n;
+	else if (ln == 10 && !memcmp(option, "write_mbps", 10)) cfg->write_mbps = n;
+	else if (ln == 9 && !memcmp(option, "cpu_share", 9))
+	{
+		if (n > 100) return false;
+		cfg->cpu_share = n;
+	}
+	else if (ln == 9 && !memcmp(option, "memory_mb", 9)) cfg->memory_mb = n;
+	else return false;
+	return true;
+}
+
+/**
+ * @brief Reads the global options from ldb.cfg in the LDB root, with an option (NAME=VALUE) per line
+ * 
+ * @param cfg[out] global options, zeroed when not set
+ * @return true if the file exists
+ */
+bool ldb_read_global_cfg(struct ldb_global_cfg *cfg)
+{
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/ldb.cfg", ldb_root);
+
+	memset(cfg, 0, sizeof(struct ldb_global_cfg));
+	FILE *fp = fopen(path, "r");
+	if (!fp) return false;
+
+	char line[LDB_MAX_NAME];
+	while (fgets(line, sizeof(line), fp))
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if (*line && !ldb_set_global_option(cfg, line))
+			printf("Warning: unknown option %s in %s\n", line, path);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+/**
+ * @brief Save the global options into ldb.cfg in the LDB root
+ * 
+ * @param cfg global options
+ */
+void ldb_write_global_cfg(struct ldb_global_cfg cfg)
+{
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/ldb.cfg", ldb_root);
+
+	FILE *fp = fopen(path, "w");
+	if (!fp) ldb_error("E065 Cannot write LDB configuration");
+
+	if (cfg.read_mbps) fprintf(fp, "read_mbps=%ld\n", cfg.read_mbps);
+	if (cfg.write_mbps) fprintf(fp, "write_mbps=%ld\n", cfg.write_mbps);
+	if (cfg.cpu_share) fprintf(fp, "cpu_share=%ld\n", cfg.cpu_share);
+	if (cfg.memory_mb) fprintf(fp, "memory_mb=%ld\n", cfg.memory_mb);
+	fclose(fp);
+}
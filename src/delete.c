@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/delete.c
+ *
+ * Delete with key files larger than memory
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file delete.c
+  * @date 18 Oct 2026
+  * @brief Deletes the keys in a key file from a table, using bounded memory
+
+  * The key file (either a hex key per line, or binary keys) is streamed once and its keys are spread
+  * into a temporary file per sector (XX.del in the table directory). Each sector file is then sorted,
+  * in memory if it fits in LDB_DELETE_MEM, otherwise as sorted runs which are merged back. Duplicated
+  * keys are dropped.
+
+  * The sector is then collated with the sorted file as a delete stream. Collate visits lists in key order,
+  * so the stream only moves forward, holding in memory just the keys for the list being collated.
+  * @see https://github.com/scanoss/ldb/blob/master/src/delete.c
+  */
+
+/**
+ * @brief Returns the path of the temporary key file for a sector
+ *
+ * @param table table struct config
+ * @param sector sector number
+ * @param path[out] path
+ */
+void ldb_delete_path(struct ldb_table table, uint8_t sector, char *path)
+{
+	sprintf(path, "%s/%s/%s/%02x.del", ldb_root, table.db, table.table, sector);
+}
+
+/**
+ * @brief Streams a key file into a temporary key file per sector
+ *
+ * @param table table struct config
+ * @param path key file path
+ * @param counts[out] number of keys per sector
+ * @return true if the key file is valid
+ */
+bool ldb_delete_partition(struct ldb_table table, char *path, uint64_t *counts)
+{
+	int key_ln = table.key_ln;
+	FILE *fp = fopen(path, "rb");
+	if (!fp) return false;
+
+	/* Text files only contain hex digits and line breaks */
+	uint8_t head[4096];
+	size_t head_ln = fread(head, 1, sizeof(head), fp);
+	bool text = head_ln > 0;
+	for (size_t i = 0; i < head_ln && text; i++)
+		if (!isxdigit(head[i]) && head[i] != '\n' && head[i] != '\r') text = false;
+	rewind(fp);
+
+	FILE *sectors[256] = {NULL};
+	char sector_path[LDB_MAX_PATH];
+	uint8_t key[256];
+	bool valid = true;
+	char *line = NULL;
+	size_t line_size = 0;
+
+	while (valid)
+	{
+		/* Read a key */
+		if (text)
+		{
+			ssize_t ln = getline(&line, &line_size, fp);
+			if (ln < 0) break;
+			ln = strcspn(line, "\r\n");
+			if (!ln) continue;
+			line[ln] = 0;
+			if (ln != key_ln * 2 || !ldb_valid_hex(line))
+			{
+				valid = false;
+				break;
+			}
+			ldb_hex_to_bin(line, ln, key);
+		}
+		else
+		{
+			size_t ln = fread(key, 1, key_ln, fp);
+			if (!ln) break;
+			if (ln != key_ln)
+			{
+				valid = false;
+				break;
+			}
+		}
+
+		/* Append it to the sector file */
+		if (!sectors[key[0]])
+		{
+			ldb_delete_path(table, key[0], sector_path);
+			sectors[key[0]] = fopen(sector_path, "wb");
+			if (!sectors[key[0]]) ldb_error("E065 Cannot write delete key file");
+		}
+		if (fwrite(key, 1, key_ln, sectors[key[0]]) != key_ln) ldb_error("E065 Cannot write delete key file");
+		counts[key[0]]++;
+	}
+
+	free(line);
+	fclose(fp);
+
+	for (int i = 0; i < 256; i++)
+	{
+		if (!sectors[i]) continue;
+		fclose(sectors[i]);
+		if (!valid)
+		{
+			ldb_delete_path(table, i, sector_path);
+			unlink(sector_path);
+			counts[i] = 0;
+		}
+	}
+
+	return valid;
+}
+
+/**
+ * @brief Writes sorted keys to a file, dropping duplicates
+ *
+ * @param fp output file
+ * @param keys sorted keys
+ * @param count number of keys
+ * @param key_ln key length
+ * @return uint64_t number of keys written
+ */
+uint64_t ldb_delete_write_unique(FILE *fp, uint8_t *keys, uint64_t count, int key_ln)
+{
+	uint64_t written = 0;
+	for (uint64_t i = 0; i < count; i++)
+	{
+		uint8_t *key = keys + i * key_ln;
+		if (i && !memcmp(key, key - key_ln, key_ln)) continue;
+		if (fwrite(key, 1, key_ln, fp) != key_ln) ldb_error("E065 Cannot write delete key file");
+		written++;
+	}
+	return written;
+}
+
+/**
+ * @brief Sorts a key file, in memory when it fits in LDB_DELETE_MEM or otherwise as sorted runs
+ * merged back into the file. Duplicated keys are dropped.
+ *
+ * @param path key file path
+ * @param key_ln key length
+ * @return uint64_t number of unique keys
+ */
+uint64_t ldb_delete_sort(char *path, int key_ln)
+{
+	uint64_t run_keys = LDB_DELETE_MEM / key_ln;
+	uint64_t count = ldb_file_size(path) / key_ln;
+	int runs = (count + run_keys - 1) / run_keys;
+	char run_path[LDB_MAX_PATH];
+	uint64_t written = 0;
+
+	uint8_t *keys = malloc((count < run_keys ? count : run_keys) * key_ln + 1);
+	ldb_cmp_width = key_ln;
+
+	FILE *fp = fopen(path, "rb");
+	if (!fp) ldb_error("E065 Cannot read delete key file");
+
+	/* Sort each run */
+	for (int r = 0; r < runs; r++)
+	{
+		uint64_t n = fread(keys, key_ln, run_keys, fp);
+		qsort(keys, n, key_ln, ldb_collate_cmp);
+
+		if (runs == 1)
+		{
+			fclose(fp);
+			fp = fopen(path, "wb");
+			written = ldb_delete_write_unique(fp, keys, n, key_ln);
+			break;
+		}
+
+		sprintf(run_path, "%s.%d", path, r);
+		FILE *run = fopen(run_path, "wb");
+		if (!run) ldb_error("E065 Cannot write delete key file");
+		ldb_delete_write_unique(run, keys, n, key_ln);
+		fclose(run);
+	}
+	fclose(fp);
+	free(keys);
+
+	if (runs < 2) return written;
+
+	/* Merge runs */
+	FILE **run = calloc(runs, sizeof(FILE *));
+	uint8_t *heads = malloc(runs * key_ln);
+	uint8_t last[256];
+	for (int r = 0; r < runs; r++)
+	{
+		sprintf(run_path, "%s.%d", path, r);
+		run[r] = fopen(run_path, "rb");
+		if (!run[r] || fread(heads + r * key_ln, 1, key_ln, run[r]) != key_ln)
+		{
+			if (run[r]) fclose(run[r]);
+			run[r] = NULL;
+		}
+	}
+
+	fp = fopen(path, "wb");
+	if (!fp) ldb_error("E065 Cannot write delete key file");
+
+	while (true)
+	{
+		int min = -1;
+		for (int r = 0; r < runs; r++)
+			if (run[r]) if (min < 0 || memcmp(heads + r * key_ln, heads + min * key_ln, key_ln) < 0) min = r;
+		if (min < 0) break;
+
+		uint8_t *key = heads + min * key_ln;
+		if (!written || memcmp(key, last, key_ln))
+		{
+			if (fwrite(key, 1, key_ln, fp) != key_ln) ldb_error("E065 Cannot write delete key file");
+			memcpy(last, key, key_ln);
+			written++;
+		}
+
+		if (fread(key, 1, key_ln, run[min]) != key_ln)
+		{
+			fclose(run[min]);
+			run[min] = NULL;
+		}
+	}
+	fclose(fp);
+
+	for (int r = 0; r < runs; r++)
+	{
+		sprintf(run_path, "%s.%d", path, r);
+		unlink(run_path);
+	}
+	free(run);
+	free(heads);
+
+	return written;
+}
+
+/**
+ * @brief Reads the next key of a delete stream
+ *
+ * @param stream delete stream
+ */
+void ldb_delete_stream_next(struct ldb_delete_stream *stream)
+{
+	stream->has_next = fread(stream->next, 1, stream->key_ln, stream->fp) == stream->key_ln;
+}
+
+/**
+ * @brief Checks if a record is to be deleted. Lists must be checked in key order, since the stream only
+ * moves forward.
+ *
+ * @param stream delete stream
+ * @param key key (32 bits)
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @return true if the key is in the stream
+ */
+bool ldb_delete_stream_match(struct ldb_delete_stream *stream, uint8_t *key, uint8_t *subkey, int subkey_ln)
+{
+	/* Load the keys for a new list */
+	if (!stream->loaded || memcmp(stream->prefix, key, LDB_KEY_LN))
+	{
+		while (stream->has_next && memcmp(stream->next, key, LDB_KEY_LN) < 0) ldb_delete_stream_next(stream);
+
+		stream->count = 0;
+		while (stream->has_next && !memcmp(stream->next, key, LDB_KEY_LN))
+		{
+			if (stream->count == stream->size)
+			{
+				stream->size = stream->size ? stream->size * 2 : 64;
+				stream->keys = realloc(stream->keys, stream->size * stream->key_ln);
+			}
+			memcpy(stream->keys + stream->count++ * stream->key_ln, stream->next, stream->key_ln);
+			ldb_delete_stream_next(stream);
+		}
+
+		memcpy(stream->prefix, key, LDB_KEY_LN);
+		stream->loaded = true;
+	}
+
+	if (!stream->count) return false;
+	if (!subkey_ln) return true;
+	return ldb_unlink_find(stream->keys, stream->count, stream->key_ln, subkey);
+}
+
+/**
+ * @brief Deletes the keys in a key file from a table, collating each affected sector
+ *
+ * @param table table struct config
+ * @param max_rec_ln maximum record length
+ * @param path key file path
+ * @return true if the key file is valid
+ */
+bool ldb_delete_file(struct ldb_table table, int max_rec_ln, char *path)
+{
+	uint64_t counts[256] = {0};
+	if (!ldb_delete_partition(table, path, counts)) return false;
+
+	struct ldb_table tmp_table = table;
+	tmp_table.tmp = true;
+	tmp_table.key_ln = LDB_KEY_LN;
+	char sector_path[LDB_MAX_PATH];
+
+	for (int i = 0; i < 256; i++)
+	{
+		if (!counts[i]) continue;
+		ldb_delete_path(table, i, sector_path);
+
+		struct ldb_delete_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		stream.key_ln = table.key_ln;
+		stream.sector = i;
+
+		uint64_t unique = ldb_delete_sort(sector_path, table.key_ln);
+		printf("Removing %'lu keys from sector %02x\n", unique, i);
+
+		/* Sectors which do not exist have nothing to delete */
+		uint8_t k0 = i;
+		FILE *ldb_sector = ldb_open(table, &k0, "r");
+		if (ldb_sector)
+		{
+			fclose(ldb_sector);
+			stream.fp = fopen(sector_path, "rb");
+			if (!stream.fp) ldb_error("E065 Cannot read delete key file");
+			ldb_delete_stream_next(&stream);
+
+			ldb_collate(table, tmp_table, max_rec_ln, false, NULL, 0, &stream);
+
+			fclose(stream.fp);
+			free(stream.keys);
+		}
+
+		unlink(sector_path);
+	}
+
+	return true;
+}
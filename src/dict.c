@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/dict.c
+ *
+ * Shared record store
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file dict.c
+  * @date 18 Oct 2026
+  * @brief Shared record store (dictionary) of tables with the "intern" option
+
+  * Record bodies which repeat across the table are stored once in DBNAME/TABLENAME.dict, and nodes hold a
+  * reference to them instead. Collate and vacuum intern the bodies as they write nodes: a body is added to
+  * the dictionary the second time it is seen (bodies seen once stay inline), and bodies shorter than
+  * LDB_DICT_MIN_LN are never interned. The writer keeps the whole dictionary in memory, with a hash table
+  * of its entries.
+
+  * Readers map the dictionary once per process (for up to LDB_DICT_CACHE tables, further tables are mapped
+  * for each node) and resolve references as nodes are read (see node.c), so
+  * the records returned are the same as in a table without the option. The dictionary is append-only,
+  * entries which are no longer referenced are only dropped by merging the table into a new one.
+
+  * DICTIONARY FILE STRUCTURE
+  * Entries:
+  * S = 16-bit body size
+  * D = body
+  * References are the 40-bit offset of an entry in the file
+
+  * INTERNED NODE DATA
+  * Node data (K, GS and R) in which a record with s = LDB_DICT_REF holds a 40-bit reference as its data
+  * @see https://github.com/scanoss/ldb/blob/master/src/dict.c
+  */
+
+#define LDB_DICT_MIN_LN 16         // Shorter bodies are stored inline
+#define LDB_DICT_SEEN (1 << 20)    // Slots for the hashes of bodies seen once
+#define LDB_DICT_CACHE 64
+
+struct ldb_dict_writer
+{
+	char path[LDB_MAX_PATH];
+	FILE *fp;
+	uint8_t *data;       // dictionary contents
+	uint64_t size;
+	uint64_t capacity;
+	uint64_t *slots;     // entry offset + 1, by body hash (0 for empty slots)
+	uint64_t slot_count; // power of 2
+	uint64_t entries;
+	uint64_t *seen;      // hashes of bodies seen once, by their lower bits
+};
+
+struct ldb_dict_map
+{
+	char path[LDB_MAX_PATH];
+	uint8_t *data;
+	uint64_t size;
+	bool owned;          // not cached, unmapped by ldb_dict_unmap
+};
+
+struct ldb_dict_writer *ldb_dict_writer = NULL;
+struct ldb_dict_map ldb_dicts[LDB_DICT_CACHE];
+pthread_mutex_t ldb_dict_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Returns the path of the table dictionary
+ *
+ * @param table table struct config
+ * @param path[out] path (LDB_MAX_PATH)
+ */
+void ldb_dict_path(struct ldb_table table, char *path)
+{
+	sprintf(path, "%s/%s/%s.dict", ldb_root, table.db, table.table);
+}
+
+/**
+ * @brief Hashes a record body (64-bit FNV-1a)
+ *
+ * @param data body
+ * @param ln body length
+ * @return uint64_t hash
+ */
+uint64_t ldb_dict_hash(uint8_t *data, uint32_t ln)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (uint32_t i = 0; i < ln; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+/**
+ * @brief Finds the slot of a body in the writer hash table
+ *
+ * @param w dictionary writer
+ * @param hash body hash
+ * @param data body
+ * @param ln body length
+ * @return uint64_t* slot holding the entry, or the empty slot where it would go
+ */
+uint64_t *ldb_dict_slot(struct ldb_dict_writer *w, uint64_t hash, uint8_t *data, uint32_t ln)
+{
+	uint64_t mask = w->slot_count - 1;
+	for (uint64_t i = hash & mask;; i = (i + 1) & mask)
+	{
+		uint64_t *slot = w->slots + i;
+		if (!*slot) return slot;
+		uint8_t *entry = w->data + *slot - 1;
+		if (uint16_read(entry) == ln && !memcmp(entry + 2, data, ln)) return slot;
+	}
+}
+
+/**
+ * @brief Adds an entry of the writer dictionary to its hash table, doubling the table when half full
+ *
+ * @param w dictionary writer
+ * @param offset entry offset
+ */
+void ldb_dict_index(struct ldb_dict_writer *w, uint64_t offset)
+{
+	if (2 * (w->entries + 1) > w->slot_count)
+	{
+		uint64_t *old = w->slots;
+		uint64_t old_count = w->slot_count;
+		w->slot_count = old_count ? old_count * 2 : 65536;
+		w->slots = calloc(w->slot_count, sizeof(uint64_t));
+		w->entries = 0;
+		for (uint64_t i = 0; i < old_count; i++) if (old[i]) ldb_dict_index(w, old[i] - 1);
+		free(old);
+	}
+
+	uint8_t *entry = w->data + offset;
+	uint32_t ln = uint16_read(entry);
+	uint64_t *slot = ldb_dict_slot(w, ldb_dict_hash(entry + 2, ln), entry + 2, ln);
+	if (!*slot)
+	{
+		*slot = offset + 1;
+		w->entries++;
+	}
+}
+
+/**
+ * @brief Opens the dictionary of a table for interning, loading it into memory. A truncated entry left
+ * by an interrupted write is overwritten by the next entries instead of being cut off, as readers could
+ * have the dictionary mapped. Only one dictionary is open for writing at a time.
+ *
+ * @param table table struct config
+ */
+void ldb_dict_writer_open(struct ldb_table table)
+{
+	ldb_dict_writer_close();
+
+	struct ldb_dict_writer *w = calloc(1, sizeof(struct ldb_dict_writer));
+	ldb_dict_path(table, w->path);
+
+	if (ldb_file_exists(w->path)) w->data = file_read(w->path, &w->size);
+
+	/* Index complete entries */
+	uint64_t ptr = 0;
+	while (ptr + 2 <= w->size && ptr + 2 + uint16_read(w->data + ptr) <= w->size)
+	{
+		ldb_dict_index(w, ptr);
+		ptr += 2 + uint16_read(w->data + ptr);
+	}
+	w->size = ptr;
+	w->capacity = ptr;
+
+	int fd = open(w->path, O_WRONLY | O_CREAT, 0644);
+	w->fp = (fd >= 0) ? fdopen(fd, "w") : NULL;
+	if (!w->fp || fseeko64(w->fp, w->size, SEEK_SET)) ldb_error("E089 Cannot write dictionary");
+	w->seen = calloc(LDB_DICT_SEEN, sizeof(uint64_t));
+	ldb_dict_writer = w;
+}
+
+/**
+ * @brief Flushes the dictionary being written to disk. Called before the sectors referencing the new
+ * entries replace the old ones.
+ */
+void ldb_dict_sync(void)
+{
+	if (!ldb_dict_writer) return;
+	fflush(ldb_dict_writer->fp);
+	fsync(fileno(ldb_dict_writer->fp));
+}
+
+/**
+ * @brief Closes the dictionary being written, if any
+ */
+void ldb_dict_writer_close(void)
+{
+	struct ldb_dict_writer *w = ldb_dict_writer;
+	if (!w) return;
+
+	ldb_dict_sync();
+	setlocale(LC_NUMERIC, "");
+	printf("Dictionary holds %'lu records (%'lu bytes)\n", w->entries, w->size);
+
+	fclose(w->fp);
+	free(w->data);
+	free(w->slots);
+	free(w->seen);
+	free(w);
+	ldb_dict_writer = NULL;
+}
+
+/**
+ * @brief Returns the reference to a record body, adding it to the dictionary if it is seen for the second time
+ *
+ * @param w dictionary writer
+ * @param data body
+ * @param ln body length
+ * @return uint64_t entry offset + 1, or 0 if the body stays inline
+ */
+uint64_t ldb_dict_ref(struct ldb_dict_writer *w, uint8_t *data, uint32_t ln)
+{
+	uint64_t hash = ldb_dict_hash(data, ln);
+	if (w->slot_count)
+	{
+		uint64_t *slot = ldb_dict_slot(w, hash, data, ln);
+		if (*slot) return *slot;
+	}
+
+	/* First sighting */
+	uint64_t *seen = w->seen + (hash & (LDB_DICT_SEEN - 1));
+	if (*seen != hash)
+	{
+		*seen = hash;
+		return 0;
+	}
+
+	/* Second sighting, append the entry */
+	uint64_t offset = w->size;
+	if (offset + 2 + ln >= ((uint64_t) 1 << 40)) return 0;
+	if (offset + 2 + ln > w->capacity)
+	{
+		w->capacity = (offset + 2 + ln) * 2;
+		w->data = realloc(w->data, w->capacity);
+	}
+	uint16_write(w->data + offset, ln);
+	memcpy(w->data + offset + 2, data, ln);
+	w->size += 2 + ln;
+
+	if (fwrite(w->data + offset, 1, 2 + ln, w->fp) != 2 + ln) ldb_error("E089 Cannot write dictionary");
+	fflush(w->fp);
+
+	ldb_dict_index(w, offset);
+	return offset + 1;
+}
+
+/**
+ * @brief Replaces the record bodies of node data with dictionary references, when the dictionary of the
+ * table is open for writing
+ *
+ * @param table table struct config
+ * @param data node data (K, GS and R)
+ * @param size node data size
+ * @param out[out] interned node data, with room for size bytes
+ * @return uint32_t interned size, zero if nothing was interned
+ */
+uint32_t ldb_dict_intern(struct ldb_table table, uint8_t *data, uint32_t size, uint8_t *out)
+{
+	struct ldb_dict_writer *w = ldb_dict_writer;
+	if (!w) return 0;
+
+	char path[LDB_MAX_PATH];
+	ldb_dict_path(table, path);
+	if (strcmp(path, w->path)) return 0;
+
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint32_t ptr = 0;
+	uint32_t out_ln = 0;
+	bool interned = false;
+
+	while (ptr < size)
+	{
+		/* K and GS, which is updated once the records are interned */
+		if (ptr + subkey_ln + 2 > size) return 0;
+		uint32_t end = ptr + subkey_ln + 2 + uint16_read(data + ptr + subkey_ln);
+		if (end > size) return 0;
+		memcpy(out + out_ln, data + ptr, subkey_ln);
+		uint32_t gs_ptr = out_ln + subkey_ln;
+		out_ln = gs_ptr + 2;
+		ptr += subkey_ln + 2;
+
+		uint32_t group_start = out_ln;
+		while (ptr < end)
+		{
+			if (ptr + 2 > end) return 0;
+			uint16_t rec_ln = uint16_read(data + ptr);
+			if (ptr + 2 + rec_ln > end || rec_ln == LDB_DICT_REF) return 0;
+
+			uint64_t ref = (rec_ln >= LDB_DICT_MIN_LN) ? ldb_dict_ref(w, data + ptr + 2, rec_ln) : 0;
+			if (ref)
+			{
+				uint16_write(out + out_ln, LDB_DICT_REF);
+				uint40_write(out + out_ln + 2, ref - 1);
+				out_ln += 2 + LDB_PTR_LN;
+				interned = true;
+			}
+			else
+			{
+				memcpy(out + out_ln, data + ptr, 2 + rec_ln);
+				out_ln += 2 + rec_ln;
+			}
+			ptr += 2 + rec_ln;
+		}
+
+		uint16_write(out + gs_ptr, out_ln - group_start);
+	}
+
+	/* The interned size is stored along, so it must save more than that */
+	return (interned && out_ln + 4 < size) ? out_ln : 0;
+}
+
+/**
+ * @brief Returns the map of a table dictionary, mapping it again if it is smaller than wanted (it has grown
+ * since it was mapped). Previous maps are kept, as other threads could still be reading them. Once all
+ * cache slots are taken by other tables, the dictionary is mapped for the caller only, and the map is
+ * released with ldb_dict_unmap.
+ *
+ * @param table table struct config
+ * @param wanted minimum size
+ * @return struct ldb_dict_map map, with no data if the dictionary cannot be mapped
+ */
+struct ldb_dict_map ldb_dict_map(struct ldb_table table, uint64_t wanted)
+{
+	char path[LDB_MAX_PATH];
+	ldb_dict_path(table, path);
+	struct ldb_dict_map map = {.data = NULL, .size = 0, .owned = false};
+	struct ldb_dict_map uncached = map;
+
+	pthread_mutex_lock(&ldb_dict_lock);
+
+	struct ldb_dict_map *cached = NULL;
+	for (int i = 0; i < LDB_DICT_CACHE && !cached; i++)
+		if (!*ldb_dicts[i].path || !strcmp(ldb_dicts[i].path, path)) cached = ldb_dicts + i;
+
+	struct ldb_dict_map *target = cached ? cached : &uncached;
+	if (!target->data || target->size < wanted)
+	{
+		int fd = open(path, O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && !fstat(fd, &st) && st.st_size > target->size)
+		{
+			uint8_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				strcpy(target->path, path);
+				target->data = data;
+				target->size = st.st_size;
+				target->owned = !cached;
+			}
+		}
+		if (fd >= 0) close(fd);
+	}
+	map = *target;
+
+	pthread_mutex_unlock(&ldb_dict_lock);
+	return map;
+}
+
+/**
+ * @brief Releases a map returned by ldb_dict_map which is not cached
+ *
+ * @param map dictionary map
+ */
+void ldb_dict_unmap(struct ldb_dict_map *map)
+{
+	if (map->owned && map->data) munmap(map->data, map->size);
+	map->data = NULL;
+	map->size = 0;
+}
+
+/**
+ * @brief Maps the table dictionary again when a reference goes beyond the current map
+ *
+ * @param table table struct config
+ * @param map[in,out] dictionary map
+ * @param wanted minimum size
+ */
+void ldb_dict_remap(struct ldb_table table, struct ldb_dict_map *map, uint64_t wanted)
+{
+	if (wanted <= map->size) return;
+	ldb_dict_unmap(map);
+	*map = ldb_dict_map(table, wanted);
+}
+
+/**
+ * @brief Restores interned node data with the given dictionary map
+ *
+ * @param table table struct config
+ * @param map[in,out] dictionary map, mapped again as needed
+ * @param in interned node data
+ * @param in_ln interned size
+ * @param out[out] node data
+ * @param size node data size (TS)
+ * @return true if exactly size bytes of node data were restored
+ */
+bool ldb_dict_resolve_map(struct ldb_table table, struct ldb_dict_map *map, uint8_t *in, uint32_t in_ln, uint8_t *out, uint32_t size)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint32_t ptr = 0;
+	uint32_t out_ln = 0;
+
+	while (ptr < in_ln)
+	{
+		/* K and GS, which is restored once the records are */
+		if (ptr + subkey_ln + 2 > in_ln || out_ln + subkey_ln + 2 > size) return false;
+		uint32_t end = ptr + subkey_ln + 2 + uint16_read(in + ptr + subkey_ln);
+		if (end > in_ln) return false;
+		memcpy(out + out_ln, in + ptr, subkey_ln);
+		uint32_t gs_ptr = out_ln + subkey_ln;
+		out_ln = gs_ptr + 2;
+		ptr += subkey_ln + 2;
+
+		uint32_t group_start = out_ln;
+		while (ptr < end)
+		{
+			if (ptr + 2 > end) return false;
+			uint16_t rec_ln = uint16_read(in + ptr);
+			uint8_t *rec = in + ptr + 2;
+
+			if (rec_ln == LDB_DICT_REF)
+			{
+				if (ptr + 2 + LDB_PTR_LN > end) return false;
+				uint64_t ref = uint40_read(rec);
+				ptr += 2 + LDB_PTR_LN;
+
+				ldb_dict_remap(table, map, ref + 2);
+				if (ref + 2 > map->size) return false;
+				rec_ln = uint16_read(map->data + ref);
+				ldb_dict_remap(table, map, ref + 2 + rec_ln);
+				if (ref + 2 + rec_ln > map->size) return false;
+				rec = map->data + ref + 2;
+			}
+			else
+			{
+				if (ptr + 2 + rec_ln > end) return false;
+				ptr += 2 + rec_ln;
+			}
+
+			if (out_ln + 2 + rec_ln > size) return false;
+			uint16_write(out + out_ln, rec_ln);
+			memcpy(out + out_ln + 2, rec, rec_ln);
+			out_ln += 2 + rec_ln;
+		}
+
+		if (out_ln - group_start > LDB_MAX_REC_LN) return false;
+		uint16_write(out + gs_ptr, out_ln - group_start);
+	}
+	return out_ln == size;
+}
+
+/**
+ * @brief Restores interned node data, replacing references with the record bodies from the dictionary
+ *
+ * @param table table struct config
+ * @param in interned node data
+ * @param in_ln interned size
+ * @param out[out] node data
+ * @param size node data size (TS)
+ * @return true if exactly size bytes of node data were restored
+ */
+bool ldb_dict_resolve(struct ldb_table table, uint8_t *in, uint32_t in_ln, uint8_t *out, uint32_t size)
+{
+	struct ldb_dict_map map = ldb_dict_map(table, 0);
+	bool resolved = ldb_dict_resolve_map(table, &map, in, in_ln, out, size);
+	ldb_dict_unmap(&map);
+	return resolved;
+}
@@ -45,13 +45,15 @@ void ldb_dump(struct ldb_table table, int hex_bytes, int sectorn)
 	if (sectorn >= 0) k0 = (uint8_t) sectorn;
 
 	do {
-		uint8_t *sector = ldb_load_sector(table, &k0);
+		struct ldb_sector_load load;
+		uint8_t *sector = ldb_sector_load(table, &k0, 0, &load);
 		if (sector)
 		{
 			/* Read each one of the (256 ^ 3) list pointers from the map */
 			uint8_t k[LDB_KEY_LN];
 			k[0] = k0;
 			for (int k1 = 0; k1 < 256; k1++)
+			{
 				for (int k2 = 0; k2 < 256; k2++)
 					for (int k3 = 0; k3 < 256; k3++)
 					{
@@ -65,7 +67,9 @@ void ldb_dump(struct ldb_table table, int hex_bytes, int sectorn)
 							ldb_fetch_recordset(sector, table, k, true, ldb_csvprint, &hex_bytes);
 						}
 					}
-			free(sector);
+				ldb_sector_slice_done(&load);
+			}
+			ldb_sector_unload(&load);
 		}
 		if (sectorn >= 0) break;
 	} while (k0++ < 255);
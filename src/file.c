@@ -29,6 +29,25 @@
   * @see https://github.com/scanoss/ldb/blob/master/src/file.c
   */
 
+#define LDB_MAP_CACHE 1024
+
+struct ldb_mapped_file
+{
+	char path[LDB_MAX_PATH];
+	uint8_t *map;
+	uint64_t size;
+	ino_t inode;
+	time_t mtime;
+	int users;      // callers between ldb_map_file and ldb_map_release
+};
+
+struct ldb_mapped_file ldb_map_cache[LDB_MAP_CACHE];
+pthread_mutex_t ldb_map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Maps replaced while still in use, unmapped by their last user */
+struct ldb_mapped_file *ldb_map_retired = NULL;
+int ldb_map_retired_count = 0;
+
 /**
  * @brief create LDB directory
  * 
@@ -134,3 +153,142 @@ bool ldb_database_exists(char *db)
 	free(path);
 	return out;
 }
+
+/**
+ * @brief Returns a read-only memory map of a file starting with the given magic. Maps are kept open for the
+ * life of the process, so that their pages stay in memory across lookups. If revalidate is set, a file that
+ * has been replaced since it was mapped is mapped again. The old map is retired and unmapped once the
+ * readers still using it release it. Every map returned must be passed to ldb_map_release after use.
+ * 
+ * @param path file path
+ * @param magic 4-byte magic expected at the beginning of the file
+ * @param min_size minimum valid file size
+ * @param size[out] file size
+ * @param cached[out] false if the map was not cached and must be unmapped by the caller
+ * @param revalidate true to check whether the file changed since it was mapped
+ * @return pointer to the mapped file, or NULL if it does not exist or is not valid
+ */
+uint8_t *ldb_map_file(char *path, char *magic, uint64_t min_size, uint64_t *size, bool *cached, bool revalidate)
+{
+	uint8_t *out = NULL;
+	*size = 0;
+	*cached = true;
+
+	struct stat st;
+	if (revalidate) if (stat(path, &st)) return NULL;
+
+	pthread_mutex_lock(&ldb_map_lock);
+
+	/* Look for the file in cache */
+	int slot = -1;
+	for (int i = 0; i < LDB_MAP_CACHE; i++)
+	{
+		struct ldb_mapped_file *m = ldb_map_cache + i;
+		if (!m->map)
+		{
+			if (slot < 0) slot = i;
+		}
+		else if (!strcmp(m->path, path))
+		{
+			if (!revalidate || (m->inode == st.st_ino && m->mtime == st.st_mtime && m->size == st.st_size))
+			{
+				out = m->map;
+				*size = m->size;
+				m->users++;
+			}
+			else
+			{
+				/* Retire the old map, unless nobody is using it */
+				if (!m->users) munmap(m->map, m->size);
+				else
+				{
+					ldb_map_retired = realloc(ldb_map_retired, (ldb_map_retired_count + 1) * sizeof(struct ldb_mapped_file));
+					ldb_map_retired[ldb_map_retired_count++] = *m;
+				}
+				memset(m, 0, sizeof(struct ldb_mapped_file));
+				slot = i;
+			}
+			break;
+		}
+	}
+
+	/* Map it otherwise */
+	if (!out)
+	{
+		int fd = open(path, O_RDONLY);
+		if (fd >= 0)
+		{
+			if (!fstat(fd, &st) && st.st_size >= min_size)
+			{
+				out = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+				if (out == MAP_FAILED) out = NULL;
+				else if (memcmp(out, magic, 4))
+				{
+					printf("E079 Corrupted file %s\n", path);
+					munmap(out, st.st_size);
+					out = NULL;
+				}
+				else
+				{
+					*size = st.st_size;
+					madvise(out, st.st_size, MADV_RANDOM);
+
+					/* Keep it in cache. If the cache is full, the caller unmaps it after use */
+					*cached = (slot >= 0);
+					if (*cached)
+					{
+						struct ldb_mapped_file *m = ldb_map_cache + slot;
+						strcpy(m->path, path);
+						m->map = out;
+						m->size = *size;
+						m->inode = st.st_ino;
+						m->mtime = st.st_mtime;
+						m->users = 1;
+					}
+				}
+			}
+			close(fd);
+		}
+	}
+
+	pthread_mutex_unlock(&ldb_map_lock);
+	return out;
+}
+
+/**
+ * @brief Releases a map returned by ldb_map_file. Maps which were not cached are unmapped, and so are
+ * retired maps once their last user releases them.
+ *
+ * @param map mapped file
+ * @param size file size
+ * @param cached cached flag returned by ldb_map_file
+ */
+void ldb_map_release(uint8_t *map, uint64_t size, bool cached)
+{
+	if (!cached)
+	{
+		munmap(map, size);
+		return;
+	}
+
+	pthread_mutex_lock(&ldb_map_lock);
+
+	bool found = false;
+	for (int i = 0; i < LDB_MAP_CACHE && !found; i++) if (ldb_map_cache[i].map == map)
+	{
+		ldb_map_cache[i].users--;
+		found = true;
+	}
+
+	for (int i = 0; i < ldb_map_retired_count && !found; i++) if (ldb_map_retired[i].map == map)
+	{
+		if (!--ldb_map_retired[i].users)
+		{
+			munmap(map, ldb_map_retired[i].size);
+			ldb_map_retired[i] = ldb_map_retired[--ldb_map_retired_count];
+		}
+		found = true;
+	}
+
+	pthread_mutex_unlock(&ldb_map_lock);
+}
@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/freeze.c
+ *
+ * Immutable, read-optimised (frozen) tables
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file freeze.c
+  * @date 18 Oct 2026
+  * @brief Converts a table into immutable .frz sectors and serves lookups from them
+
+  * A frozen sector replaces the map and the linked lists of an .ldb sector with a sorted key index
+  * pointing at a contiguous block per key. Blocks hold the node data of the original list, so the usual
+  * record handlers apply unchanged. Lookups search the (memory-mapped) index and read a single block.
+
+  * FROZEN SECTOR STRUCTURE
+  * Header:
+  * M = "LDBF" magic
+  * N = 32-bit number of keys in the index
+  * I = 40-bit offset of the index (zero padded to 64 bits)
+
+  * Blocks (one per key, in key order) follow the header. The index is a sorted array of N entries:
+  * K = the last three bytes of the 32-bit key (the first byte is the sector)
+  * P = 40-bit offset of the block
+  * L = 32-bit length of the block
+  * @see https://github.com/scanoss/ldb/blob/master/src/freeze.c
+  */
+
+#define LDB_FRZ_MAGIC "LDBF"
+#define LDB_FRZ_HEADER_LN 16
+#define LDB_FRZ_ENTRY_LN 12
+
+/**
+ * @brief Returns the first (up to) eight bytes of a key as a big endian integer
+ *
+ * @param key key
+ * @param key_ln key length
+ * @return uint64_t key value
+ */
+uint64_t ldb_index_key_value(uint8_t *key, int key_ln)
+{
+	uint64_t out = 0;
+	for (int i = 0; i < 8; i++) out = (out << 8) | (i < key_ln ? key[i] : 0);
+	return out;
+}
+
+/**
+ * @brief Searches a sorted array of fixed size entries starting with a key. Keys in LDB are hashes and
+ * therefore uniformly distributed, so interpolation finds most keys in one or two probes. The search falls back to
+ * bisection if interpolation does not converge quickly.
+ *
+ * @param index sorted entries
+ * @param count number of entries
+ * @param entry_ln length of an entry
+ * @param key key to search
+ * @param key_ln length of the key (at the beginning of each entry)
+ * @return pointer to the matching entry or NULL if not found
+ */
+uint8_t *ldb_index_search(uint8_t *index, uint64_t count, int entry_ln, uint8_t *key, int key_ln)
+{
+	if (!count) return NULL;
+
+	uint64_t lo = 0;
+	uint64_t hi = count - 1;
+	uint64_t target = ldb_index_key_value(key, key_ln);
+	int probes = 0;
+
+	while (lo <= hi)
+	{
+		uint64_t vlo = ldb_index_key_value(index + lo * entry_ln, key_ln);
+		uint64_t vhi = ldb_index_key_value(index + hi * entry_ln, key_ln);
+		if (target < vlo || target > vhi) return NULL;
+
+		/* Interpolate position, or bisect if not converging */
+		uint64_t mid = lo + (hi - lo) / 2;
+		if (vhi > vlo && probes++ < 4)
+			mid = lo + (uint64_t) ((long double) (target - vlo) / (vhi - vlo) * (hi - lo));
+
+		uint8_t *entry = index + mid * entry_ln;
+		int cmp = memcmp(entry, key, key_ln);
+		if (!cmp) return entry;
+
+		if (cmp < 0) lo = mid + 1;
+		else
+		{
+			if (!mid) return NULL;
+			hi = mid - 1;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Returns the path to the frozen sector for the given key
+ *
+ * @param table table struct
+ * @param key key
+ * @param path[out] output path (LDB_MAX_PATH)
+ * @param ext file extension (frz or a temporary extension)
+ */
+void ldb_frozen_path(struct ldb_table table, uint8_t *key, char *path, char *ext)
+{
+	sprintf(path, "%s/%s/%s/%02x.%s", ldb_root, table.db, table.table, key[0], ext);
+}
+
+/**
+ * @brief Returns a memory map of the frozen sector for the given key
+ *
+ * @param table table struct
+ * @param key key
+ * @param size[out] size of the sector
+ * @param cached[out] false if the map was not cached (passed to ldb_map_release after use)
+ * @return pointer to the mapped sector, or NULL if it does not exist
+ */
+uint8_t *ldb_frozen_sector(struct ldb_table table, uint8_t *key, uint64_t *size, bool *cached)
+{
+	char path[LDB_MAX_PATH];
+	ldb_frozen_path(table, key, path, "frz");
+
+	/* Frozen sectors never change, there is no need to revalidate them */
+	return ldb_map_file(path, LDB_FRZ_MAGIC, LDB_FRZ_HEADER_LN, size, cached, false);
+}
+
+/**
+ * @brief Recurses all records in a frozen table for key, like ldb_fetch_recordset
+ *
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records found
+ */
+uint32_t ldb_frozen_fetch(struct ldb_table table, uint8_t *key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	uint64_t size = 0;
+	bool cached = true;
+	uint8_t *sector = ldb_frozen_sector(table, key, &size, &cached);
+	if (!sector) return 0;
+
+	uint32_t count = uint32_read(sector + 4);
+	uint64_t index = uint40_read(sector + 8);
+	uint8_t *entry = NULL;
+
+	if (index + (uint64_t) count * LDB_FRZ_ENTRY_LN <= size)
+		entry = ldb_index_search(sector + index, count, LDB_FRZ_ENTRY_LN, key + 1, LDB_KEY_LN - 1);
+
+	uint64_t block = 0;
+	uint32_t block_ln = 0;
+	if (entry)
+	{
+		block = uint40_read(entry + 3);
+		block_ln = uint32_read(entry + 3 + LDB_PTR_LN);
+		if (block + block_ln > size) block_ln = 0;
+	}
+
+	uint32_t records = 0;
+
+	/* Fixed-length records are passed in node sized chunks */
+	if (table.rec_ln)
+	{
+		uint32_t chunk = (LDB_MAX_FIXED_NODE_LN / table.rec_ln) * table.rec_ln;
+		for (uint32_t ptr = 0; ptr < block_ln; ptr += chunk)
+		{
+			uint32_t ln = (block_ln - ptr < chunk) ? block_ln - ptr : chunk;
+			if (ldb_fetch_node_records(table, key, skip_subkey, sector + block + ptr, ln, &records, ldb_record_handler, void_ptr)) break;
+		}
+	}
+	else if (block_ln) ldb_fetch_node_records(table, key, skip_subkey, sector + block, block_ln, &records, ldb_record_handler, void_ptr);
+
+	ldb_map_release(sector, size, cached);
+	return records;
+}
+
+/**
+ * @brief Writes the frozen version of a sector loaded in memory
+ *
+ * @param table table struct
+ * @param sector sector loaded in memory
+ * @param k0 sector number
+ * @return number of keys written
+ */
+long ldb_freeze_sector(struct ldb_table table, uint8_t *sector, uint8_t k0)
+{
+	char path[LDB_MAX_PATH];
+	uint8_t k[LDB_KEY_LN] = {k0, 0, 0, 0};
+	ldb_frozen_path(table, k, path, "frz.tmp");
+
+	FILE *out = fopen(path, "w");
+	if (!out) ldb_error("E065 Cannot create frozen sector");
+
+	/* Leave room for the header */
+	uint8_t header[LDB_FRZ_HEADER_LN] = "\0";
+	fwrite(header, 1, LDB_FRZ_HEADER_LN, out);
+	uint64_t ptr = LDB_FRZ_HEADER_LN;
+
+	long capacity = 65536;
+	long count = 0;
+	uint8_t *index = malloc(capacity * LDB_FRZ_ENTRY_LN);
+	uint8_t *node = NULL;
+
+	/* Read each one of the (256 ^ 3) lists */
+	for (int k1 = 0; k1 < 256; k1++)
+		for (int k2 = 0; k2 < 256; k2++)
+			for (int k3 = 0; k3 < 256; k3++)
+			{
+				k[1] = k1;
+				k[2] = k2;
+				k[3] = k3;
+
+				if (!uint40_read(sector + ldb_map_pointer_pos(k))) continue;
+
+				/* Copy node data from the list into a contiguous block */
+				uint64_t next = 0;
+				uint32_t node_size = 0;
+				uint32_t block_ln = 0;
+				do
+				{
+					next = ldb_node_read(sector, table, NULL, next, k, &node_size, &node, 0);
+					if (node_size)
+					{
+						if (node_size != fwrite(node, 1, node_size, out)) ldb_error("E058 Error writing frozen sector");
+						block_ln += node_size;
+					}
+				} while (next);
+
+				if (!block_ln) continue;
+
+				/* Add to index */
+				if (count == capacity)
+				{
+					capacity *= 2;
+					index = realloc(index, capacity * LDB_FRZ_ENTRY_LN);
+				}
+				uint8_t *entry = index + count * LDB_FRZ_ENTRY_LN;
+				memcpy(entry, k + 1, LDB_KEY_LN - 1);
+				uint40_write(entry + 3, ptr);
+				uint32_write(entry + 3 + LDB_PTR_LN, block_ln);
+				ptr += block_ln;
+				count++;
+			}
+
+	/* Write index and header */
+	if (count * LDB_FRZ_ENTRY_LN != fwrite(index, 1, count * LDB_FRZ_ENTRY_LN, out)) ldb_error("E058 Error writing frozen sector");
+	memcpy(header, LDB_FRZ_MAGIC, 4);
+	uint32_write(header + 4, count);
+	uint40_write(header + 8, ptr);
+	fseeko64(out, 0, SEEK_SET);
+	fwrite(header, 1, LDB_FRZ_HEADER_LN, out);
+
+	fflush(out);
+	fsync(fileno(out));
+	fclose(out);
+	free(index);
+
+	/* Replace .ldb with .frz */
+	char frz[LDB_MAX_PATH];
+	char ldb[LDB_MAX_PATH];
+	ldb_frozen_path(table, k, frz, "frz");
+	ldb_frozen_path(table, k, ldb, "ldb");
+	if (rename(path, frz)) ldb_error("E074 Error replacing sector with .frz");
+	unlink(ldb);
+
+	return count;
+}
+
+/**
+ * @brief Converts all table sectors into frozen sectors and marks the table as frozen
+ *
+ * @param table table struct
+ */
+void ldb_freeze(struct ldb_table table)
+{
+	uint8_t k0 = 0;
+	long total = 0;
+	setlocale(LC_NUMERIC, "");
+
+	do {
+		struct ldb_sector_load load;
+		uint8_t *sector = ldb_sector_load(table, &k0, 0, &load);
+		if (sector)
+		{
+			printf("Freezing sector %02x\n", k0);
+			long keys = ldb_freeze_sector(table, sector, k0);
+			printf("%'ld keys written\n", keys);
+			total += keys;
+			ldb_sector_unload(&load);
+		}
+	} while (k0++ < 255);
+
+	table.frozen = true;
+	ldb_update_cfg(table);
+
+	printf("Freeze completed with %'ld keys\n", total);
+	fflush(stdout);
+}
@@ -313,6 +313,49 @@ void uint40_write(uint8_t *pointer, uint64_t value)
 	memcpy(pointer, (uint8_t*)&value, 5);
 }
 
+/**
+ * @brief Write an unsigned integer as a varint (7 bits per byte, least significant first, with the top bit
+ * set on all bytes but the last) in the provided location, which must have room for 5 bytes
+ *
+ * @param pointer Pointer to write to
+ * @param value Value to write
+ * @return int Bytes written
+ */
+int varint_write(uint8_t *pointer, uint32_t value)
+{
+	int ln = 0;
+	while (value >= 0x80)
+	{
+		pointer[ln++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	pointer[ln++] = value;
+	return ln;
+}
+
+/**
+ * @brief Read a varint from the provided pointer, without going past end
+ *
+ * @param pointer Pointer to read from
+ * @param end End of the readable data
+ * @param value[out] Value read
+ * @return int Bytes read, zero if the varint is truncated or over 32 bits
+ */
+int varint_read(uint8_t *pointer, uint8_t *end, uint32_t *value)
+{
+	uint32_t out = 0;
+	for (int ln = 0; ln < 5 && pointer + ln < end; ln++)
+	{
+		out |= (uint32_t) (pointer[ln] & 0x7f) << (7 * ln);
+		if (!(pointer[ln] & 0x80))
+		{
+			*value = out;
+			return ln + 1;
+		}
+	}
+	return 0;
+}
+
 /**
  * @brief Verify if a memory block of 4 bytes is all zeros
  * 
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/index.c
+ *
+ * Sorted key index for collated sectors
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file index.c
+  * @date 18 Oct 2026
+  * @brief Sorted key index emitted by collate for variable-length tables with the "index" option
+
+  * The index holds every full key in a collated sector, pointing at the first node holding its records.
+  * Since keys are hashes, the index is searched by interpolation (see ldb_index_search). An index is only
+  * valid for the exact sector it was built for: any write into the sector changes its size and the
+  * index is ignored until the next collate.
+
+  * SECTOR INDEX STRUCTURE (XX.idx)
+  * Header:
+  * M = "LDBI" magic
+  * N = 32-bit number of entries
+  * S = 40-bit size of the .ldb sector the index was built for (zero padded to 64 bits)
+
+  * Entries (sorted by key):
+  * K = the full key without its first byte (which is the sector)
+  * P = 40-bit pointer to the first node holding records for the key
+  * R = 32-bit number of records for the key
+  * @see https://github.com/scanoss/ldb/blob/master/src/index.c
+  */
+
+#define LDB_IDX_MAGIC "LDBI"
+#define LDB_IDX_HEADER_LN 16
+#define LDB_IDX_ENTRY_LN(key_ln) ((key_ln) - 1 + LDB_PTR_LN + 4)
+
+/**
+ * @brief Adds a key to the index being built by collate
+ *
+ * @param collate pointer to collate data structure
+ * @param key full key
+ */
+void ldb_collate_index_add(struct ldb_collate_data *collate, uint8_t *key)
+{
+	int entry_ln = LDB_IDX_ENTRY_LN(collate->table_key_ln);
+
+	/* A list split across nodes continues its last entry */
+	if (collate->idx_count)
+	{
+		uint8_t *last = collate->idx + (collate->idx_count - 1) * entry_ln;
+		if (!memcmp(last, key + 1, collate->table_key_ln - 1)) return;
+	}
+
+	if (collate->idx_count == collate->idx_capacity)
+	{
+		collate->idx_capacity = collate->idx_capacity ? collate->idx_capacity * 2 : 65536;
+		collate->idx = realloc(collate->idx, collate->idx_capacity * entry_ln);
+	}
+
+	uint8_t *entry = collate->idx + collate->idx_count * entry_ln;
+	memcpy(entry, key + 1, collate->table_key_ln - 1);
+	uint40_write(entry + collate->table_key_ln - 1, 0);
+	uint32_write(entry + collate->table_key_ln - 1 + LDB_PTR_LN, 0);
+	collate->idx_count++;
+}
+
+/**
+ * @brief Counts a record for the last key added to the index being built by collate
+ *
+ * @param collate pointer to collate data structure
+ */
+void ldb_collate_index_count(struct ldb_collate_data *collate)
+{
+	if (!collate->idx_count) return;
+	int entry_ln = LDB_IDX_ENTRY_LN(collate->table_key_ln);
+	uint8_t *records = collate->idx + (collate->idx_count - 1) * entry_ln + collate->table_key_ln - 1 + LDB_PTR_LN;
+	uint32_write(records, uint32_read(records) + 1);
+}
+
+/**
+ * @brief Points the keys added since the last node write to the node about to be written for key
+ *
+ * @param collate pointer to collate data structure
+ * @param key list key
+ */
+void ldb_collate_index_node(struct ldb_collate_data *collate, uint8_t *key)
+{
+	if (collate->idx_pending == collate->idx_count) return;
+
+	/* The node goes at the end of the sector, after LN if it starts a new list */
+	uint64_t list = ldb_list_pointer(collate->out_sector, key);
+	fseeko64(collate->out_sector, 0, SEEK_END);
+	uint64_t node = ftello64(collate->out_sector) + (list ? 0 : LDB_PTR_LN);
+
+	int entry_ln = LDB_IDX_ENTRY_LN(collate->table_key_ln);
+	for (long i = collate->idx_pending; i < collate->idx_count; i++)
+		uint40_write(collate->idx + i * entry_ln + collate->table_key_ln - 1, node);
+
+	collate->idx_pending = collate->idx_count;
+}
+
+/**
+ * @brief Writes the index for a collated sector
+ *
+ * @param table table struct
+ * @param key sector key
+ * @param idx index entries
+ * @param count number of entries
+ */
+void ldb_index_write(struct ldb_table table, uint8_t *key, uint8_t *idx, long count)
+{
+	char path[LDB_MAX_PATH];
+	char tmp_path[LDB_MAX_PATH];
+	char sector_path[LDB_MAX_PATH];
+	sprintf(path, "%s/%s/%s/%02x.idx", ldb_root, table.db, table.table, key[0]);
+	sprintf(tmp_path, "%s/%s/%s/%02x.idx.tmp", ldb_root, table.db, table.table, key[0]);
+	sprintf(sector_path, "%s/%s/%s/%02x.ldb", ldb_root, table.db, table.table, key[0]);
+
+	FILE *out = fopen(tmp_path, "w");
+	if (!out)
+	{
+		printf("E065 Cannot create %s\n", tmp_path);
+		return;
+	}
+
+	uint8_t header[LDB_IDX_HEADER_LN] = "\0";
+	memcpy(header, LDB_IDX_MAGIC, 4);
+	uint32_write(header + 4, count);
+	uint40_write(header + 8, ldb_file_size(sector_path));
+
+	size_t idx_ln = count * LDB_IDX_ENTRY_LN(table.key_ln);
+	bool ok = (fwrite(header, 1, LDB_IDX_HEADER_LN, out) == LDB_IDX_HEADER_LN);
+	if (ok) ok = (fwrite(idx, 1, idx_ln, out) == idx_ln);
+	fclose(out);
+
+	if (!ok || rename(tmp_path, path))
+	{
+		printf("Warning: cannot write %s\n", path);
+		unlink(tmp_path);
+	}
+}
+
+/**
+ * @brief Looks up a full key in the sector index
+ *
+ * @param table table struct
+ * @param key full key
+ * @param node[out] pointer to the first node holding records for the key
+ * @param records[out] number of records for the key
+ * @return 1 if the key was found, 0 if it is not in the table, -1 if there is no valid index
+ */
+int ldb_index_lookup(struct ldb_table table, uint8_t *key, uint64_t *node, uint32_t *records)
+{
+	char path[LDB_MAX_PATH];
+	char sector_path[LDB_MAX_PATH];
+	sprintf(path, "%s/%s/%s/%02x.idx", ldb_root, table.db, table.table, key[0]);
+	sprintf(sector_path, "%s/%s/%s/%02x.ldb", ldb_root, table.db, table.table, key[0]);
+
+	struct stat st;
+	if (stat(sector_path, &st)) return -1;
+
+	uint64_t size = 0;
+	bool cached = true;
+	uint8_t *idx = ldb_map_file(path, LDB_IDX_MAGIC, LDB_IDX_HEADER_LN, &size, &cached, true);
+	if (!idx) return -1;
+
+	int out = -1;
+	int entry_ln = LDB_IDX_ENTRY_LN(table.key_ln);
+	uint32_t count = uint32_read(idx + 4);
+
+	/* Make sure the index was built for the current sector */
+	if (uint40_read(idx + 8) == st.st_size && LDB_IDX_HEADER_LN + (uint64_t) count * entry_ln <= size)
+	{
+		uint8_t *entry = ldb_index_search(idx + LDB_IDX_HEADER_LN, count, entry_ln, key + 1, table.key_ln - 1);
+		out = 0;
+		if (entry)
+		{
+			*node = uint40_read(entry + table.key_ln - 1);
+			*records = uint32_read(entry + table.key_ln - 1 + LDB_PTR_LN);
+			out = 1;
+		}
+	}
+
+	ldb_map_release(idx, size, cached);
+	return out;
+}
+
+/**
+ * @brief Removes the sector index for key. Used by operations which modify a sector without changing its size.
+ *
+ * @param table table struct
+ * @param key sector key
+ */
+void ldb_index_drop(struct ldb_table table, uint8_t *key)
+{
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/%s/%s/%02x.idx", ldb_root, table.db, table.table, key[0]);
+	if (ldb_file_exists(path)) unlink(path);
+}
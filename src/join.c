@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/join.c
+ *
+ * Lookup join between two tables
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file join.c
+  * @date 18 Oct 2026
+  * @brief Fetches the records for a key in table A, extracts a key from each record and looks it up in table B
+
+  * Keys extracted from A are grouped in batches of LDB_JOIN_BATCH. Each full batch is handed to a worker
+  * thread (up to the given number of threads at once) while A is still being read. Workers sort their keys, so B is
+  * read in sector and map order with each sector opened once, and look up repeated keys only once. As soon as a
+  * batch and those before it are looked up, its rows are passed to the handler in the order of the A records and
+  * the batch is freed, so memory is bound by the batches in flight.
+  * @see https://github.com/scanoss/ldb/blob/master/src/join.c
+  */
+
+/**
+ * @brief Extracts the key for table B from a record of table A
+ * 
+ * @param join join data
+ * @param data record
+ * @param size record length
+ * @param key[out] extracted key (join->key_ln bytes)
+ * @return true if a key was found
+ */
+bool ldb_join_extract(struct ldb_join *join, uint8_t *data, uint32_t size, uint8_t *key)
+{
+	/* Binary key at a fixed position */
+	if (!join->field)
+	{
+		if (join->position + join->key_ln > size) return false;
+		memcpy(key, data + join->position, join->key_ln);
+		return true;
+	}
+
+	/* Hex key in a CSV field */
+	uint8_t *field = data;
+	uint8_t *end = data + size;
+	for (int i = 1; i < join->field; i++)
+	{
+		field = memchr(field, ',', end - field);
+		if (!field) return false;
+		field++;
+	}
+
+	uint8_t *field_end = memchr(field, ',', end - field);
+	long field_ln = (field_end ? field_end : end) - field;
+	if (field_ln != join->key_ln * 2) return false;
+
+	char hex[2 * 256 + 1];
+	for (int i = 0; i < field_ln; i++) hex[i] = tolower(field[i]);
+	hex[field_ln] = 0;
+	if (!ldb_valid_hex(hex)) return false;
+
+	ldb_hex_to_bin(hex, field_ln, key);
+	return true;
+}
+
+/**
+ * @brief Compares two 64-bit values (for qsort)
+ * 
+ * @param a pointer to first value
+ * @param b pointer to second value
+ * @return int comparison result
+ */
+int ldb_join_cmp(const void *a, const void *b)
+{
+	uint64_t va = *(const uint64_t *) a;
+	uint64_t vb = *(const uint64_t *) b;
+	return (va > vb) - (va < vb);
+}
+
+/**
+ * @brief Thread function looking up the keys of a batch in table B
+ * 
+ * @param ptr pointer to the ldb_join_batch
+ * @return NULL
+ */
+void *ldb_join_lookup(void *ptr)
+{
+	struct ldb_join_batch *batch = ptr;
+	struct ldb_join *join = batch->join;
+	int key_ln = join->key_ln;
+
+	/* Sort keys by their first 32 bits (sector and list), keeping their position */
+	uint64_t *order = malloc(batch->count * sizeof(uint64_t));
+	for (long i = 0; i < batch->count; i++) order[i] = ((uint64_t) ldb_bitmap_key(batch->keys + i * key_ln) << 32) | i;
+	qsort(order, batch->count, sizeof(uint64_t), ldb_join_cmp);
+
+	FILE *ldb_sector = NULL;
+	int sector = -1;
+
+	long run_start = 0;
+	for (long i = 0; i < batch->count; i++)
+	{
+		long pos = order[i] & 0xffffffff;
+		uint8_t *key = batch->keys + pos * key_ln;
+		batch->result[pos] = pos;
+
+		/* Keys with the same first 32 bits are adjacent, look for a repeated key among them */
+		if (i && (order[i] >> 32) != (order[i - 1] >> 32)) run_start = i;
+		for (long j = run_start; j < i; j++)
+		{
+			long prev = order[j] & 0xffffffff;
+			if (batch->result[prev] == prev && !memcmp(batch->keys + prev * key_ln, key, key_ln))
+			{
+				batch->result[pos] = prev;
+				break;
+			}
+		}
+
+		if (batch->result[pos] != pos) continue;
+
+		/* Open each sector once */
+		if (!join->table.frozen && key[0] != sector)
+		{
+			if (ldb_sector) fclose(ldb_sector);
+			ldb_sector = ldb_open(join->table, key, "r");
+			sector = key[0];
+		}
+
+		ldb_fetch_open_list(ldb_sector, join->table, key, key_ln == LDB_KEY_LN, ldb_multi_collect_handler, batch->records + pos);
+	}
+
+	if (ldb_sector) fclose(ldb_sector);
+	free(order);
+
+	pthread_mutex_lock(&join->lock);
+	batch->finished = true;
+	pthread_mutex_unlock(&join->lock);
+	return NULL;
+}
+
+/**
+ * @brief Tells if the lookup of a batch has completed
+ * 
+ * @param batch batch
+ * @return true if its rows can be passed to the handler
+ */
+bool ldb_join_finished(struct ldb_join_batch *batch)
+{
+	pthread_mutex_lock(&batch->join->lock);
+	bool finished = batch->finished;
+	pthread_mutex_unlock(&batch->join->lock);
+	return finished;
+}
+
+/**
+ * @brief Waits for the lookup of the oldest batch, passes its joined rows to the handler in A order and frees it
+ * 
+ * @param join join data
+ */
+void ldb_join_emit(struct ldb_join *join)
+{
+	struct ldb_join_batch *batch = join->batches[join->joined];
+	join->batches[join->joined++] = NULL;
+	if (batch->started) pthread_join(batch->thread, NULL);
+
+	int key_ln = join->key_ln;
+	for (long i = 0; i < batch->count && !join->done; i++)
+	{
+		struct ldb_record_buffer *records = batch->records + batch->result[i];
+		uint64_t ptr = 0;
+		while (ptr < records->ln && !join->done)
+		{
+			uint8_t *record = records->data + ptr;
+			int subkey_ln = *record;
+			uint32_t size = uint32_read(record + 1 + subkey_ln);
+			ptr += 1 + subkey_ln + 4 + size;
+			join->rows++;
+
+			join->done = join->handler(join->key, batch->a_records + batch->a_ptr[i], batch->a_size[i], batch->keys + i * key_ln, key_ln, record + 1 + subkey_ln + 4, size, join->ptr);
+		}
+	}
+
+	for (long i = 0; i < batch->count; i++) free(batch->records[i].data);
+	free(batch->records);
+	free(batch->keys);
+	free(batch->a_records);
+	free(batch->a_ptr);
+	free(batch->a_size);
+	free(batch->result);
+	free(batch);
+}
+
+/**
+ * @brief Starts the lookup of the current batch, waiting for the oldest batch if LDB_JOIN_THREADS are busy.
+ * The rows of the batches which have been looked up are then passed to the handler, in order.
+ * 
+ * @param join join data
+ */
+void ldb_join_dispatch(struct ldb_join *join)
+{
+	struct ldb_join_batch *batch = join->current;
+	if (!batch) return;
+	join->current = NULL;
+
+	if (join->batch_count - join->joined >= (join->threads ? join->threads : 1)) ldb_join_emit(join);
+
+	join->batches = realloc(join->batches, (join->batch_count + 1) * sizeof(struct ldb_join_batch *));
+	join->batches[join->batch_count++] = batch;
+
+	if (join->threads) batch->started = !pthread_create(&batch->thread, NULL, ldb_join_lookup, batch);
+	if (!batch->started) ldb_join_lookup(batch);
+
+	while (join->joined < join->batch_count && ldb_join_finished(join->batches[join->joined])) ldb_join_emit(join);
+}
+
+/**
+ * @brief Adds a record of table A to the join
+ * 
+ * @param join join data
+ * @param data record
+ * @param size record length
+ */
+void ldb_join_add(struct ldb_join *join, uint8_t *data, uint32_t size)
+{
+	uint8_t key[256];
+	if (!ldb_join_extract(join, data, size, key)) return;
+
+	/* Start a new batch */
+	if (!join->current)
+	{
+		struct ldb_join_batch *batch = calloc(1, sizeof(struct ldb_join_batch));
+		batch->join = join;
+		batch->keys = malloc(LDB_JOIN_BATCH * join->key_ln);
+		batch->a_ptr = malloc(LDB_JOIN_BATCH * sizeof(uint64_t));
+		batch->a_size = malloc(LDB_JOIN_BATCH * sizeof(uint32_t));
+		batch->result = malloc(LDB_JOIN_BATCH * sizeof(long));
+		batch->records = calloc(LDB_JOIN_BATCH, sizeof(struct ldb_record_buffer));
+		join->current = batch;
+	}
+
+	/* Keep a copy of the A record */
+	struct ldb_join_batch *batch = join->current;
+	if (batch->a_records_ln + size > batch->a_records_size)
+	{
+		batch->a_records_size = (batch->a_records_ln + size) * 2;
+		batch->a_records = realloc(batch->a_records, batch->a_records_size);
+	}
+	memcpy(batch->a_records + batch->a_records_ln, data, size);
+
+	memcpy(batch->keys + batch->count * join->key_ln, key, join->key_ln);
+	batch->a_ptr[batch->count] = batch->a_records_ln;
+	batch->a_size[batch->count] = size;
+	batch->count++;
+	batch->a_records_ln += size;
+
+	if (batch->count == LDB_JOIN_BATCH) ldb_join_dispatch(join);
+}
+
+/**
+ * @brief Handler function for reading table A in ldb_join_records
+ * 
+ * @param key Not used
+ * @param subkey Not used
+ * @param subkey_ln Not used
+ * @param data record (or node of fixed-length records)
+ * @param size data length
+ * @param iteration Not used
+ * @param ptr pointer to the ldb_join
+ * @return true once the join handler has requested to stop
+ */
+bool ldb_join_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr)
+{
+	struct ldb_join *join = ptr;
+
+	if (!join->rec_ln) ldb_join_add(join, data, size);
+	else for (uint32_t i = 0; i + join->rec_ln <= size && !join->done; i += join->rec_ln) ldb_join_add(join, data + i, join->rec_ln);
+
+	return join->done;
+}
+
+/**
+ * @brief Joins the records for *key* in table *a* with the records in table *b* for the key extracted from each
+ * of them. The key for *b* is either a hex string in CSV field number *field*, or *key_ln* binary bytes from *position*.
+ * Rows are passed to the handler in A order, a batch at a time while A is still being read.
+ * 
+ * @param a table A
+ * @param key key for table A
+ * @param skip_subkey true for skip the subkey (of table A)
+ * @param b table B
+ * @param key_ln length of the extracted keys (4 bytes or the key length of table B)
+ * @param field CSV field number holding the key (starting at 1), or 0 for a binary key
+ * @param position position of the binary key in the records (when field is 0)
+ * @param threads maximum concurrent lookup threads, or 0 to look up each batch in the calling thread
+ * @param ldb_join_handler handler receiving each joined row (A key, A record, A record length, B key, B key length, B record, B record length, ptr)
+ * @param void_ptr pointer passed to the handler
+ * @return uint32_t number of joined rows
+ */
+uint32_t ldb_join_records(struct ldb_table a, uint8_t *key, bool skip_subkey, struct ldb_table b, int key_ln, int field, int position, int threads, bool (*ldb_join_row_handler) (uint8_t *, uint8_t *, uint32_t, uint8_t *, int, uint8_t *, uint32_t, void *), void *void_ptr)
+{
+	struct ldb_join join;
+	memset(&join, 0, sizeof(join));
+	join.table = b;
+	join.key_ln = key_ln;
+	join.field = field;
+	join.position = position;
+	join.rec_ln = a.rec_ln;
+	join.threads = threads;
+	join.key = key;
+	join.handler = ldb_join_row_handler;
+	join.ptr = void_ptr;
+	pthread_mutex_init(&join.lock, NULL);
+
+	/* Read A, while batches of keys are looked up in B */
+	ldb_fetch_recordset(NULL, a, key, skip_subkey, ldb_join_handler, &join);
+	ldb_join_dispatch(&join);
+
+	/* Pass on the remaining batches */
+	while (join.joined < join.batch_count) ldb_join_emit(&join);
+
+	pthread_mutex_destroy(&join.lock);
+	free(join.batches);
+	return join.rows;
+}
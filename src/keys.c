@@ -80,13 +80,15 @@ void ldb_dump_keys(struct ldb_table table)
 	table.last_key = calloc(table.key_ln, 1);
 
 	do {
-		uint8_t *sector = ldb_load_sector(table, &k0);
+		struct ldb_sector_load load;
+		uint8_t *sector = ldb_sector_load(table, &k0, 0, &load);
 		if (sector)
 		{
 			/* Read each one of the (256 ^ 3) list pointers from the map */
 			uint8_t k[LDB_KEY_LN];
 			k[0] = k0;
 			for (int k1 = 0; k1 < 256; k1++)
+			{
 				for (int k2 = 0; k2 < 256; k2++)
 					for (int k3 = 0; k3 < 256; k3++)
 					{
@@ -100,7 +102,9 @@ void ldb_dump_keys(struct ldb_table table)
 							ldb_fetch_recordset(sector, table, k, true, ldb_dump_keys_handler, &table);
 						}
 					}
-			free(sector);
+				ldb_sector_slice_done(&load);
+			}
+			ldb_sector_unload(&load);
 		}
 	} while (k0++ < 255);
 
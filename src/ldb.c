@@ -54,6 +54,22 @@
 #include "sector.c"
 #include "string.c"
 #include "keys.c"
+#include "wal.c"
+#include "freeze.c"
+#include "index.c"
+#include "bitmap.c"
+#include "multi.c"
+#include "join.c"
+#include "sample.c"
+#include "merge.c"
+#include "vacuum.c"
+#include "unlink.c"
+#include "delete.c"
+#include "checkpoint.c"
+#include "throttle.c"
+#include "memory.c"
+#include "sort.c"
+#include "dict.c"
 
 
 /* Global */
@@ -73,7 +89,9 @@ char *ldb_commands[] =
 	"select from {ascii} key {hex} ascii",
 	"select from {ascii} key {hex} csv hex {ascii}",
 	"select from {ascii} key {hex} hex",
+	"delete from {ascii} max {ascii} keys from {ascii}",
 	"delete from {ascii} max {ascii} keys {ascii}",
+	"collate status {ascii}",
 	"collate {ascii} max {ascii}",
 	"merge {ascii} into {ascii} max {ascii}",
 	"version",
@@ -81,7 +99,22 @@ char *ldb_commands[] =
 	"dump {ascii} hex {ascii} sector {hex}",
 	"dump {ascii} hex {ascii}",
 	"dump keys from {ascii}",
-	"cat {hex} from {ascii}"
+	"cat {hex} from {ascii}",
+	"alter table {ascii} set {ascii}",
+	"alter table {ascii} unset {ascii}",
+	"wal replay {ascii}",
+	"freeze {ascii}",
+	"count from {ascii} key {hex}",
+	"count from {ascii} keys {ascii}",
+	"join {ascii} key {hex} field {ascii} with {ascii}",
+	"join {ascii} key {hex} bytes {ascii} with {ascii}",
+	"sample {ascii} from {ascii} key {hex}",
+	"sample {ascii} from {ascii}",
+	"update {ascii} key {hex} match {ascii} hex {hex}",
+	"vacuum {ascii}",
+	"unlink keys from {ascii} file {ascii}",
+	"set {ascii}",
+	"show settings"
 };
 int ldb_commands_count = sizeof(ldb_commands) / sizeof(ldb_commands[0]);
 
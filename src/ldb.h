@@ -25,16 +25,22 @@
 #include <dirent.h>
 #include <errno.h>
 #include <locale.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 #include <openssl/md5.h>
+#include <zlib.h>
 
 #define LDB_VERSION "3.1.2"
 #define LDB_MAX_PATH 1024
@@ -46,8 +52,22 @@
 #define LDB_MAP_SIZE (256 * 256 * 256 * 5) // Size of sector map
 #define LDB_MAX_NODE_DATA_LN (4 * 1048576) // Maximum length for a data record in a node (4Mb)
 #define LDB_MAX_NODE_LN ((256 * 256 * 18) - 1)
+#define LDB_MAX_FIXED_NODE_LN 64800 // Maximum data read from a node of fixed-length records
 #define LDB_MAX_COMMAND_SIZE (64 * 1024)   // Maximum length for an LDB command statement
 #define COLLATE_REPORT_SEC 5 // Report interval for collate status
+#define LDB_MAX_MULTI 32 // Maximum number of tables in a multi-table select
+#define LDB_JOIN_BATCH 4096 // Keys per lookup batch in a join
+#define LDB_JOIN_THREADS 4 // Default concurrent lookup threads in a join
+#define LDB_MAX_FILTER_LN 256 // Maximum length of the value in a select filter
+#define LDB_VACUUM_REWRITE 50 // Percentage of dead space in a sector which makes vacuum rewrite it
+#define LDB_DELETE_MEM (64 * 1048576) // Memory used for sorting the keys of a delete key file
+#define LDB_STREAM_MIN (16 * 1048576) // Minimum memory left for streaming a sector within the memory budget
+#define LDB_SORT_PARALLEL 65536 // Items in a list which make collate sort it in parallel
+#define LDB_SORT_THREADS 8 // Maximum worker threads for parallel sorts
+#define LDB_DICT_REF 0xffff // Record size marking a dictionary reference in interned node data
+#define LDB_DICT_NODE 0x80000000 // ZS flag of packed nodes holding interned data
+#define LDB_WAL_BATCH (16 * 1048576) // Write-ahead log size that triggers applying it into the sectors
+#define LDB_WAL_CACHE 8 // Logs of wal tables kept parsed in memory, to serve reads of pending inserts
 #define MD5_LEN 16
 #define BUFFER_SIZE 1048576
 
@@ -77,7 +97,9 @@ INSERT_HEX,
 SELECT_ASCII,
 SELECT_CSV,
 SELECT, 
+DELETE_FILE,
 DELETE,
+COLLATE_STATUS,
 COLLATE,
 MERGE,
 VERSION,
@@ -85,7 +107,22 @@ UNLINK_LIST,
 DUMP_SECTOR,
 DUMP,
 DUMP_KEYS,
-CAT_MZ
+CAT_MZ,
+ALTER_TABLE_SET,
+ALTER_TABLE_UNSET,
+WAL_REPLAY,
+FREEZE,
+COUNT,
+COUNT_KEYS,
+JOIN_FIELD,
+JOIN_BYTES,
+SAMPLE_KEY,
+SAMPLE,
+UPDATE,
+VACUUM,
+UNLINK_KEYS,
+SET,
+SHOW_SETTINGS
 } commandtype;
 
 struct ldb_stats
@@ -102,10 +139,41 @@ struct ldb_table
 	int  rec_ln; // data record length, otherwise 0 for variable-length data
     int  ts_ln;  // 2 or 4 (16-bit or 32-bit reserved for total sector size)
 	bool tmp; // is this a .tmp sector instead of a .ldb?
+	bool wal; // inserts are appended to a write-ahead log and applied to sectors in batches
+	bool frozen; // sectors have been converted into immutable .frz sectors
+	bool index; // collate emits a sorted key index for each sector (variable-length records)
+	bool bitmap; // collate builds an in-memory key presence bitmap (32-bit keys)
+	bool compress; // node data is stored zlib compressed (variable-length records)
+	bool frontcode; // node subkeys are front-coded and sizes stored as varints (variable-length records)
+	bool intern; // repeated record bodies are stored once in the table dictionary (variable-length records)
+	uint8_t merge; // read-time merge policy (see ldb_merge_policy)
+	int merge_field; // key field for LDB_MERGE_LAST (CSV field, or leading bytes of fixed-length records)
 	uint8_t *current_key;
 	uint8_t *last_key;
 };
 
+struct ldb_global_cfg
+{
+	long read_mbps;  // read rate limit for maintenance tasks (MB/s), 0 for none
+	long write_mbps; // write rate limit for maintenance tasks (MB/s), 0 for none
+	long cpu_share;  // CPU share for maintenance tasks (percentage), 0 for none
+	long memory_mb;  // memory budget for collate and bulk sector loads (MB), 0 for none
+};
+
+typedef enum
+{
+	LDB_LOAD_FULL,  // sector read into memory
+	LDB_LOAD_MMAP,  // sector mapped, pages reclaimed by the kernel as needed
+	LDB_LOAD_STREAM // sector mapped, pages dropped after each slice of the map is processed
+} ldb_load_mode;
+
+struct ldb_sector_load
+{
+	uint8_t *data;
+	uint64_t size;
+	ldb_load_mode mode;
+};
+
 struct ldb_recordset
 {
 	char db[LDB_MAX_NAME];
@@ -123,11 +191,165 @@ struct ldb_recordset
     uint8_t ts_ln;      // 2 or 4 (16-bit or 32-bit reserved for total sector size)
 };
 
+typedef enum {
+LDB_FILTER_BYTES,        // bytes at position equal value
+LDB_FILTER_FIELD_EQUALS, // CSV field number position (starting at 1) equals value
+LDB_FILTER_FIELD_STARTS  // CSV field number position (starting at 1) starts with value
+} ldb_filter_type;
+
+struct ldb_filter
+{
+	ldb_filter_type type;
+	uint32_t position;
+	uint8_t value[LDB_MAX_FILTER_LN];
+	int value_ln;
+};
+
+struct ldb_fetch_range
+{
+	uint32_t offset;  // records to skip
+	uint32_t limit;   // maximum records to pass to the handler (0 for no limit)
+	uint32_t skipped; // records skipped so far
+	uint32_t passed;  // records passed to the handler so far
+	uint32_t calls;   // handler calls so far
+	int rec_ln;       // fixed record length, or 0
+	struct ldb_filter *filter; // records not matching the filter are dropped (optional)
+	bool (*handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *);
+	void *ptr;
+};
+
+struct ldb_select_tag
+{
+	char table[LDB_MAX_PATH]; // db/table
+	bool (*handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *);
+	void *ptr;
+	int width;
+};
+
+struct ldb_record_buffer
+{
+	uint8_t *data; // buffered records (see multi.c)
+	uint64_t ln;
+	uint64_t size;
+};
+
+struct ldb_multi_job
+{
+	struct ldb_table table;
+	uint8_t *key;
+	bool skip_subkey;
+	struct ldb_filter *filter;
+	uint32_t offset;
+	uint32_t limit;
+	struct ldb_record_buffer records;
+	pthread_t thread;
+	bool started;
+};
+
+struct ldb_join_batch
+{
+	struct ldb_join *join;
+	long count;
+	uint8_t *keys;     // keys for table B
+	uint8_t *a_records; // copies of the A records
+	uint64_t a_records_ln;
+	uint64_t a_records_size;
+	uint64_t *a_ptr;   // A record for each key (offset in a_records)
+	uint32_t *a_size;
+	long *result;      // entry holding the B records for each key (repeated keys are looked up once)
+	struct ldb_record_buffer *records;
+	pthread_t thread;
+	bool started;
+	bool finished;     // lookup completed (guarded by the join lock)
+};
+
+struct ldb_join
+{
+	struct ldb_table table; // table B
+	int key_ln;             // length of the keys for table B
+	int field;              // CSV field holding the hex key (starting at 1), or 0 for a binary key
+	int position;           // position of the binary key
+	int rec_ln;             // fixed record length of table A
+	int threads;            // maximum concurrent lookup threads (0 for none)
+	uint8_t *key;           // key for table A
+	struct ldb_join_batch **batches;
+	long batch_count;
+	long joined;            // batches joined (and passed to the handler) so far
+	struct ldb_join_batch *current;
+	pthread_mutex_t lock;
+	uint32_t rows;          // rows passed to the handler
+	bool done;              // the handler requested to stop
+	bool (*handler) (uint8_t *, uint8_t *, uint32_t, uint8_t *, int, uint8_t *, uint32_t, void *);
+	void *ptr;
+};
+
+typedef enum
+{
+	LDB_MERGE_ALL,   // all records are returned
+	LDB_MERGE_DEDUP, // only the first of identical records is returned
+	LDB_MERGE_LAST   // only the last written record is returned for each value of the key field
+} ldb_merge_policy;
+
+struct ldb_merge_record
+{
+	uint8_t *subkey;
+	uint8_t subkey_ln;
+	uint8_t *data;
+	uint32_t size;
+	uint8_t *field; // value compared by the merge policy
+	uint32_t field_ln;
+	uint64_t hash;
+	bool keep;
+};
+
+struct ldb_sample_item
+{
+	uint8_t key[LDB_KEY_LN]; // list key
+	uint64_t node;           // node location
+	uint32_t record;         // chosen record in the node
+};
+
+struct ldb_sample
+{
+	struct ldb_sample_item *items; // reservoir
+	uint32_t size;                 // reservoir size
+	uint32_t count;                // items in the reservoir
+	uint64_t seen;                 // records seen so far
+	uint64_t next;                 // next record to be chosen
+	double w;
+	bool skip_subkey;              // count records of all subkeys
+	uint8_t *node;                 // node buffer
+};
+
+struct ldb_delete_stream
+{
+	FILE *fp;                    // sorted key file
+	int key_ln;
+	uint8_t sector;
+	uint8_t next[256];           // next key in the file
+	bool has_next;
+	uint8_t prefix[LDB_KEY_LN];  // list for which keys are loaded
+	bool loaded;
+	uint8_t *keys;               // keys for the list
+	uint64_t count;
+	uint64_t size;
+};
+
+struct ldb_collate_rec
+{
+	uint64_t offset; // subkey and data in the collate arena
+	uint32_t size;   // data length
+	uint32_t prefix; // leading bytes of subkey and data (big-endian), for a quick comparison
+};
+
 struct ldb_collate_data
 {
-	void *data; 
-	void *tmp_data;
+	void *data; // fixed-length records, or arena of variable-length records
 	long data_ptr;
+	uint64_t data_size;
+	struct ldb_collate_rec *recs; // variable-length records in the list
+	long list_count;
+	long recs_size;
 	int table_key_ln;
 	int table_rec_ln;
 	int max_rec_ln;
@@ -142,6 +364,13 @@ struct ldb_collate_data
 	long del_ln;
 	long del_count;
 	long *del_map;
+	struct ldb_delete_stream *del_stream;
+	bool index;
+	uint8_t *idx;
+	long idx_count;
+	long idx_capacity;
+	long idx_pending;
+	struct ldb_bitmap *bitmap;
 };
 
 /* MZ  */
@@ -194,10 +423,12 @@ struct mz_job
 
 bool ldb_file_exists(char *path);
 bool ldb_dir_exists(char *path);
+uint64_t ldb_file_size(char *path);
 bool ldb_locked();
 void ldb_error (char *txt);
 void ldb_prepare_dir(char *path);
 void ldb_lock(char * db_table);
+bool ldb_lock_try(char * db_table);
 void ldb_unlock(char * db_table);
 void ldb_create_sector(char *sector_path);
 void ldb_uint40_write(FILE *ldb_sector, uint64_t value);
@@ -211,15 +442,27 @@ uint32_t uint32_read(uint8_t *pointer);
 void uint32_write(uint8_t *pointer, uint32_t value);
 uint64_t uint40_read(uint8_t *pointer);
 void uint40_write(uint8_t *pointer, uint64_t value);
+int varint_write(uint8_t *pointer, uint32_t value);
+int varint_read(uint8_t *pointer, uint8_t *end, uint32_t *value);
 uint64_t ldb_map_pointer_pos(uint8_t *key);
 uint64_t ldb_list_pointer(FILE *ldb_sector, uint8_t *key);
 uint64_t ldb_last_node_pointer(FILE *ldb_sector, uint64_t list_pointer);
 void ldb_update_list_pointers(FILE *ldb_sector, uint8_t *key, uint64_t list, uint64_t new_node);
 void ldb_node_write (struct ldb_table table, FILE *ldb_sector, uint8_t *key, uint8_t *data, uint32_t dataln, uint16_t records);
+uint64_t ldb_node_skip (uint8_t *sector, struct ldb_table table, FILE *ldb_sector, uint64_t ptr, uint8_t *key, uint32_t *node_size);
+uint8_t *ldb_node_buffer(int n, uint32_t size);
+bool ldb_node_packed(struct ldb_table table);
+uint32_t ldb_node_frontcode(struct ldb_table table, uint8_t *data, uint32_t size, uint8_t *out, bool interned);
+bool ldb_node_frontdecode(struct ldb_table table, uint8_t *in, uint32_t in_ln, uint8_t *out, uint32_t size, bool interned);
+bool ldb_node_decode(struct ldb_table table, uint8_t *zdata, uint32_t zdata_ln, uint8_t *data, uint32_t size, bool interned);
+uint32_t ldb_node_pack(struct ldb_table table, uint8_t *data, uint32_t size);
+bool ldb_node_unpack(struct ldb_table table, uint8_t *zdata, uint32_t zs, uint8_t *data, uint32_t size);
+uint32_t ldb_node_data_read(struct ldb_table table, FILE *ldb_sector, uint32_t size, uint8_t *out);
 uint64_t ldb_node_read (uint8_t *sector, struct ldb_table table, FILE *ldb_sector, uint64_t ptr, uint8_t *key, uint32_t *bytes_read, uint8_t **out, int max_node_size);
 char *ldb_sector_path (struct ldb_table table, uint8_t *key, char *mode, bool tmp);
 FILE *ldb_open (struct ldb_table table, uint8_t *key, char *mode);
 void ldb_node_unlink (struct ldb_table table, uint8_t *key);
+int ldb_node_update(struct ldb_table table, uint8_t *key, uint8_t *record, int match_ln);
 void ldb_hexprint(uint8_t *data, uint32_t len, uint8_t width);
 void ldb_hex_to_bin(char *hex, int hex_ln, uint8_t *out);
 void ldb_bin_to_hex(uint8_t *bin, uint32_t len, char *out);
@@ -229,6 +472,30 @@ bool ldb_valid_ascii(char *str);
 void ldb_trim(char *str);
 struct ldb_table ldb_read_cfg(char *db_table);
 void ldb_write_cfg(char *db, char *table, int keylen, int reclen);
+void ldb_update_cfg(struct ldb_table table);
+bool ldb_set_cfg_option(struct ldb_table *table, char *option, int ln, bool enable);
+bool ldb_set_global_option(struct ldb_global_cfg *cfg, char *option);
+bool ldb_read_global_cfg(struct ldb_global_cfg *cfg);
+void ldb_write_global_cfg(struct ldb_global_cfg cfg);
+void ldb_throttle_read(uint64_t bytes);
+void ldb_throttle_write(uint64_t bytes);
+void ldb_throttle_cpu(void);
+uint64_t ldb_memory_budget(void);
+uint64_t ldb_collate_memory(struct ldb_table table, int max_rec_ln);
+bool ldb_collate_memory_check(struct ldb_table table, int max_rec_ln);
+uint8_t *ldb_sector_load(struct ldb_table table, uint8_t *key, uint64_t reserved, struct ldb_sector_load *load);
+void ldb_sector_slice_done(struct ldb_sector_load *load);
+void ldb_sector_unload(struct ldb_sector_load *load);
+int ldb_pool_size(void);
+void ldb_pool_run(void (*task) (void *), void *args, size_t arg_size, int count);
+void ldb_sort(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg);
+size_t ldb_sort_unique(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg);
+void ldb_dict_writer_open(struct ldb_table table);
+void ldb_dict_writer_close(void);
+void ldb_dict_sync(void);
+uint32_t ldb_dict_intern(struct ldb_table table, uint8_t *data, uint32_t size, uint8_t *out);
+bool ldb_dict_resolve(struct ldb_table table, uint8_t *in, uint32_t in_ln, uint8_t *out, uint32_t size);
+size_t ldb_unique(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg);
 int ldb_split_string(char *string, char separator);
 bool ldb_valid_name(char *str);
 char *ldb_extract_word(int n, char *wordlist);
@@ -241,6 +508,19 @@ char *ldb_command_normalize(char *text);
 void ldb_command_show_tables(char *command);
 void ldb_command_show_databases();
 void ldb_command_select(char *command, select_format format);
+bool ldb_command_select_range(char *command, uint32_t *limit, uint32_t *offset);
+int ldb_command_select_filter(char *command, struct ldb_filter *filter);
+void ldb_command_select_multi(char *dbtables, char *key, select_format format, int hex_bytes, struct ldb_filter *filter, uint32_t offset, uint32_t limit);
+void ldb_command_count(char *command, commandtype type);
+void ldb_command_join(char *command, commandtype type);
+void ldb_command_sample(char *command, commandtype type);
+void ldb_command_update(char *command);
+void ldb_command_vacuum(char *command);
+void ldb_command_unlink_keys(char *command);
+void ldb_command_delete_file(char *command);
+void ldb_command_collate_status(char *command);
+void ldb_command_set(char *command);
+void ldb_command_show_settings();
 void ldb_command_telect(char *command);
 void ldb_command_insert(char *command, commandtype type);
 void ldb_command_create_table(char *command);
@@ -257,17 +537,74 @@ bool ldb_validate_node(uint8_t *node, uint32_t node_size, int subkey_ln);
 bool uint32_is_zero(uint8_t *n);
 bool ldb_key_exists(struct ldb_table table, uint8_t *key);
 bool ldb_key_in_recordset(uint8_t *rs, uint32_t rs_len, uint8_t *subkey, uint8_t subkey_ln);
+bool ldb_fetch_node_records(struct ldb_table table, uint8_t *key, bool skip_subkey, uint8_t *node, uint32_t node_size, uint32_t *records, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_frozen_fetch(struct ldb_table table, uint8_t *key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint8_t *ldb_map_file(char *path, char *magic, uint64_t min_size, uint64_t *size, bool *cached, bool revalidate);
+void ldb_map_release(uint8_t *map, uint64_t size, bool cached);
+int ldb_index_lookup(struct ldb_table table, uint8_t *key, uint64_t *node, uint32_t *records);
+void ldb_index_drop(struct ldb_table table, uint8_t *key);
+void ldb_index_write(struct ldb_table table, uint8_t *key, uint8_t *idx, long count);
+void ldb_collate_index_add(struct ldb_collate_data *collate, uint8_t *key);
+void ldb_collate_index_count(struct ldb_collate_data *collate);
+void ldb_collate_index_node(struct ldb_collate_data *collate, uint8_t *key);
+uint8_t *ldb_index_search(uint8_t *index, uint64_t count, int entry_ln, uint8_t *key, int key_ln);
+void ldb_freeze(struct ldb_table table);
+uint32_t ldb_count_records(struct ldb_table table, uint8_t *key, bool skip_subkey);
+void ldb_count_records_batch(struct ldb_table table, uint8_t *keys, int key_ln, long count, uint32_t *records);
+struct ldb_bitmap *ldb_bitmap_new(void);
+struct ldb_bitmap *ldb_bitmap_load(struct ldb_table table);
+void ldb_bitmap_save(struct ldb_table table, struct ldb_bitmap *bitmap);
+void ldb_bitmap_free(struct ldb_bitmap *bitmap);
+void ldb_bitmap_add(struct ldb_bitmap *bitmap, uint32_t value);
+void ldb_bitmap_clear_sector(struct ldb_bitmap *bitmap, uint8_t k0);
+void ldb_bitmap_load_sector(struct ldb_table table, struct ldb_bitmap *bitmap, uint8_t k0);
+uint32_t ldb_bitmap_key(uint8_t *key);
+void ldb_bitmap_log(struct ldb_table table, uint8_t *key, bool add);
+int ldb_bitmap_key_exists(struct ldb_table table, uint8_t *key);
 uint32_t ldb_fetch_recordset(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_fetch_recordset_filter(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, struct ldb_filter *filter, uint32_t offset, uint32_t limit, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_fetch_recordset_multi(struct ldb_table *tables, int table_count, uint8_t *key, bool skip_subkey, struct ldb_filter *filter, uint32_t offset, uint32_t limit, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void **void_ptrs);
+uint32_t ldb_join_records(struct ldb_table a, uint8_t *key, bool skip_subkey, struct ldb_table b, int key_ln, int field, int position, int threads, bool (*ldb_join_row_handler) (uint8_t *, uint8_t *, uint32_t, uint8_t *, int, uint8_t *, uint32_t, void *), void *void_ptr);
+bool ldb_multi_collect_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr);
+void ldb_vacuum(struct ldb_table table);
+uint8_t *ldb_load_key_file(char *path, int key_ln, uint64_t *count);
+uint64_t ldb_unlink_keys(struct ldb_table table, uint8_t *keys, uint64_t count);
+bool ldb_unlink_find(uint8_t *keys, uint64_t count, int key_ln, uint8_t *subkey);
+bool ldb_delete_stream_match(struct ldb_delete_stream *stream, uint8_t *key, uint8_t *subkey, int subkey_ln);
+bool ldb_delete_file(struct ldb_table table, int max_rec_ln, char *path);
+void ldb_checkpoint_sector_path(struct ldb_table table, int sector, char *ext, char *path);
+bool ldb_checkpoint_load(struct ldb_table table, bool *done);
+void ldb_checkpoint_start(struct ldb_table table);
+void ldb_checkpoint_sector(struct ldb_table table, int sector, long records, uint64_t bytes, long seconds);
+void ldb_checkpoint_clear(struct ldb_table table);
+void ldb_checkpoint_cleanup(struct ldb_table table, bool *done);
+void ldb_checkpoint_status(struct ldb_table table);
+uint32_t ldb_merge_fetch(uint8_t *sector, struct ldb_table table, uint8_t *key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_sample(struct ldb_table table, uint8_t *key, bool skip_subkey, uint32_t n, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_count_node_records(struct ldb_table table, uint8_t *key, bool skip_subkey, uint8_t *node, uint32_t node_size);
+bool ldb_filter_match(struct ldb_filter *filter, uint8_t *data, uint32_t size);
+uint32_t ldb_fetch_recordset_range(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, uint32_t offset, uint32_t limit, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_fetch_list(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, struct ldb_fetch_range *range, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
+uint32_t ldb_fetch_open_list(FILE *ldb_sector, struct ldb_table table, uint8_t* key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
 bool ldb_asciiprint(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr);
 bool ldb_csvprint(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr);
 bool ldb_hexprint_width(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr);
 bool ldb_hexprint16(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr);
-void ldb_collate(struct ldb_table table, struct ldb_table tmp_table, int max_rec_ln, bool merge, uint8_t *del_keys, long del_ln);
+void ldb_collate(struct ldb_table table, struct ldb_table tmp_table, int max_rec_ln, bool merge, uint8_t *del_keys, long del_ln, struct ldb_delete_stream *del_stream);
 void ldb_sector_update(struct ldb_table table, uint8_t *key);
 void ldb_sector_erase(struct ldb_table table, uint8_t *key);
 void ldb_dump(struct ldb_table table, int hex_bytes, int sector);
 void ldb_dump_keys(struct ldb_table table);
 int ldb_collate_cmp(const void * a, const void * b);
+int ldb_collate_cmp_r(const void *a, const void *b, void *ptr);
+bool ldb_wal_append(struct ldb_table table, uint8_t *key, uint8_t *data, uint32_t dataln, uint16_t records);
+bool ldb_wal_apply(struct ldb_table table);
+bool ldb_wal_apply_try(struct ldb_table table, bool report);
+void ldb_wal_recover(void);
+void ldb_wal_recover_table(struct ldb_table table);
+int ldb_wal_read_lock(struct ldb_table table);
+void ldb_wal_read_unlock(int fd);
+bool ldb_wal_fetch(struct ldb_table table, int fd, uint8_t *key, bool skip_subkey, uint32_t *records, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr);
 
 bool mz_key_exists(struct mz_job *job, uint8_t *key);
 bool mz_id_exists(uint8_t *mz, uint64_t size, uint8_t *id);
@@ -29,6 +29,24 @@
   * @see https://github.com/scanoss/ldb/blob/master/src/lock.c
   */
 
+/**
+ * @brief Returns the path of the lock file for a table, which is named after the table
+ *
+ * @param db_table table name, either as db/table or table
+ * @param file_lock[out] lock file path (LDB_MAX_PATH)
+ */
+void ldb_lock_file(char * db_table, char * file_lock)
+{
+	char * table_name = strrchr(db_table,'/');
+
+	if (!table_name)
+		table_name = db_table;
+	else
+		table_name++;
+
+	sprintf(file_lock,"%s.%s", ldb_lock_path, table_name);
+}
+
 /**
  * @brief Verifies if the db is locked.
  * Reads the file ldb.lock and if exists the db is locked. Otherwise is free to use.
@@ -38,48 +56,38 @@
 bool ldb_locked(char * db_name)
 {
 	char file_lock[LDB_MAX_PATH];
-	sprintf(file_lock,"%s.%s", ldb_lock_path, db_name);
+	ldb_lock_file(db_name, file_lock);
 	return ldb_file_exists (file_lock);
 }
 
 /**
- * @brief Lock LDB for writing
- * 
+ * @brief Tries to lock a table for writing. The lock file is created atomically, so that only one
+ * process can get the lock.
+ *
+ * @param db_table table name, as db/table
+ * @return true if the lock was taken, false if the table is already locked
  */
-void ldb_lock(char * db_table)
+bool ldb_lock_try(char * db_table)
 {
 	pid_t pid = getpid();
 	char file_lock[LDB_MAX_PATH];
+	ldb_lock_file(db_table, file_lock);
 
-	char * table_name = strrchr(db_table,'/');
-	
-	if (!table_name)
-		table_name = db_table;
-	else
-		table_name++;
-
-	sprintf(file_lock,"%s.%s", ldb_lock_path, table_name);
-	
-	if (ldb_locked(db_table)) ldb_error ("E051 Concurrent ldb writing not supported (/dev/shm/ldb.lock exists)");
-
-	/* Write lock file */
-	FILE *lock = fopen (file_lock, "wb");
-
-	if (!lock)
-	{
-		printf("Failed to create lock file %s\n", file_lock);
-		exit(1);
-	}
+	int fd = open(file_lock, O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) return false;
 
-	if (!fwrite (&pid, 4, 1, lock)) printf("Warning: cannot write lock file\n");
-	fclose (lock);
-
-	/* Validate lock file */
-	lock = fopen (file_lock, "rb");
-	if (!fread (&pid, 4, 1, lock)) printf("Warning: cannot read lock file\n");
-	fclose (lock);
+	if (write(fd, &pid, 4) != 4) printf("Warning: cannot write lock file\n");
+	close(fd);
+	return true;
+}
 
-	if (pid != getpid()) ldb_error ("E052 Concurrent ldb writing is not supported. (check /dev/shm/ldb.lock)");
+/**
+ * @brief Lock LDB for writing
+ * 
+ */
+void ldb_lock(char * db_table)
+{
+	if (!ldb_lock_try(db_table)) ldb_error ("E051 Concurrent ldb writing not supported (/dev/shm/ldb.lock exists)");
 }
 
 /**
@@ -89,7 +97,7 @@ void ldb_lock(char * db_table)
 void ldb_unlock(char * db_table)
 {
 	char file_lock[LDB_MAX_PATH];
-	sprintf(file_lock,"%s.%s", ldb_lock_path, db_table);
+	ldb_lock_file(db_table, file_lock);
 	unlink(file_lock);
 }
 
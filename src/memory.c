@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/memory.c
+ *
+ * Memory budget for collate and bulk sector loads
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file memory.c
+  * @date 18 Oct 2026
+  * @brief Keeps collate and bulk sector loads (dump, dump keys, freeze) within the memory_mb global option
+
+  * Collate needs a list buffer sized for the largest list (LDB_MAX_RECORDS), with the scratch array for
+  * sorting it, plus the sector. The buffer is reserved first and is checked before the collate starts,
+  * failing with E087 if it does not fit.
+  * Each sector is then loaded in the first mode which fits in what is left:
+  * - full: the sector is read into memory
+  * - mmap: the sector is mapped read-only. The map, which is walked in full, fits in memory and node
+  *   pages are reclaimed by the kernel as needed
+  * - stream: the sector is mapped as above, and its pages are dropped after each 1/256 of the map is
+  *   processed, so that only the lists under way stay resident (at least LDB_STREAM_MIN must be left)
+  * With no budget set, sectors are always read into memory.
+  * @see https://github.com/scanoss/ldb/blob/master/src/memory.c
+  */
+
+/**
+ * @brief Returns the memory budget from the global options, as last loaded by ldb_throttle_refresh
+ *
+ * @return uint64_t budget in bytes, 0 for none
+ */
+uint64_t ldb_memory_budget(void)
+{
+	pthread_mutex_lock(&ldb_throttle_lock);
+	ldb_throttle_refresh();
+	long memory_mb = ldb_throttle.memory_mb;
+	pthread_mutex_unlock(&ldb_throttle_lock);
+	return (uint64_t) memory_mb * 1048576;
+}
+
+/**
+ * @brief Returns the memory used by collate besides the sector, which is the list buffer, the scratch
+ * array of a parallel sort and the node buffer. Variable-length records only take their actual size,
+ * this is the worst case.
+ *
+ * @param table table struct config
+ * @param max_rec_ln maximum record length
+ * @return uint64_t bytes
+ */
+uint64_t ldb_collate_memory(struct ldb_table table, int max_rec_ln)
+{
+	uint64_t rec_width = table.rec_ln;
+	uint64_t sort_width = table.rec_ln;
+	if (!rec_width)
+	{
+		sort_width = sizeof(struct ldb_collate_rec);
+		rec_width = table.key_ln - LDB_KEY_LN + max_rec_ln + sort_width;
+	}
+	return LDB_MAX_RECORDS * (rec_width + sort_width) + LDB_MAX_REC_LN;
+}
+
+/**
+ * @brief Checks that a collate fits in the memory budget, at least streaming the sectors
+ *
+ * @param table table struct config
+ * @param max_rec_ln maximum record length
+ * @return true if it fits
+ */
+bool ldb_collate_memory_check(struct ldb_table table, int max_rec_ln)
+{
+	uint64_t budget = ldb_memory_budget();
+	uint64_t needed = ldb_collate_memory(table, max_rec_ln) + LDB_STREAM_MIN;
+	if (!budget || needed <= budget) return true;
+
+	printf("E087 Collate with max %d needs %lu MB, over the memory budget of %lu MB\n",
+			max_rec_ln, (needed + 1048575) / 1048576, budget / 1048576);
+	return false;
+}
+
+/**
+ * @brief Loads a sector in the first mode which fits in the memory budget
+ *
+ * @param table table struct config
+ * @param key key of the sector
+ * @param reserved memory already reserved by the caller
+ * @param load[out] loaded sector, to be released with ldb_sector_unload
+ * @return uint8_t* sector data, or NULL if the sector does not exist
+ */
+uint8_t *ldb_sector_load(struct ldb_table table, uint8_t *key, uint64_t reserved, struct ldb_sector_load *load)
+{
+	memset(load, 0, sizeof(struct ldb_sector_load));
+
+	FILE *ldb_sector = ldb_open(table, key, "r");
+	if (!ldb_sector) return NULL;
+	fseeko64(ldb_sector, 0, SEEK_END);
+	load->size = ftello64(ldb_sector);
+
+	uint64_t budget = ldb_memory_budget();
+	uint64_t available = budget > reserved ? budget - reserved : 0;
+
+	/* Read in chunks, so that maintenance read limits are honoured */
+	if (!budget || load->size <= available)
+	{
+		load->mode = LDB_LOAD_FULL;
+		load->data = malloc(load->size);
+		fseeko64(ldb_sector, 0, SEEK_SET);
+
+		for (uint64_t ptr = 0; ptr < load->size; )
+		{
+			uint64_t chunk = load->size - ptr > BUFFER_SIZE ? BUFFER_SIZE : load->size - ptr;
+			if (fread(load->data + ptr, 1, chunk, ldb_sector) != chunk)
+			{
+				printf("Warning: ldb_sector_load failed\n");
+				break;
+			}
+			ptr += chunk;
+			ldb_throttle_read(chunk);
+		}
+
+		fclose(ldb_sector);
+		return load->data;
+	}
+
+	load->data = mmap(NULL, load->size, PROT_READ, MAP_SHARED, fileno(ldb_sector), 0);
+	fclose(ldb_sector);
+	if (load->data == MAP_FAILED) ldb_error("E087 Cannot map sector within the memory budget");
+
+	load->mode = (available >= LDB_MAP_SIZE) ? LDB_LOAD_MMAP : LDB_LOAD_STREAM;
+	return load->data;
+}
+
+/**
+ * @brief Called after each 1/256 of the sector map is processed. Mapped sectors are charged to the
+ * maintenance read limit in proportion, and streamed sectors drop their pages.
+ *
+ * @param load loaded sector
+ */
+void ldb_sector_slice_done(struct ldb_sector_load *load)
+{
+	if (load->mode == LDB_LOAD_FULL) return;
+	ldb_throttle_read(load->size / 256);
+	if (load->mode == LDB_LOAD_STREAM) madvise(load->data, load->size, MADV_DONTNEED);
+}
+
+/**
+ * @brief Releases a loaded sector
+ *
+ * @param load loaded sector
+ */
+void ldb_sector_unload(struct ldb_sector_load *load)
+{
+	if (!load->data) return;
+	if (load->mode == LDB_LOAD_FULL) free(load->data);
+	else munmap(load->data, load->size);
+	load->data = NULL;
+}
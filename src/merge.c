@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/merge.c
+ *
+ * Read-time merge policies
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file merge.c
+  * @date 18 Oct 2026
+  * @brief Applies the merge policy of a table to the records of a list as they are fetched
+
+  * Inserts only append, so until the next collate a list may hold duplicated or superseded records.
+  * With the "dedup" table option only the first of identical records is returned. With "upsert=N" only
+  * the last written record is returned for each value of a key field, which is the CSV field N (starting
+  * at 1) for variable-length records or the first N bytes of fixed-length records. The subkey is part of
+  * the compared value in both cases.
+
+  * The list is buffered (see multi.c) and records are compared through an open addressing hash set
+  * which lives for the duration of the call. Surviving records are then passed to the handler one by one,
+  * in their original order. Since collate reads lists the same way, it makes the policy permanent.
+  * @see https://github.com/scanoss/ldb/blob/master/src/merge.c
+  */
+
+/**
+ * @brief Hashes a block of data (FNV-1a)
+ *
+ * @param data data
+ * @param ln data length
+ * @param hash initial value
+ * @return uint64_t hash
+ */
+uint64_t ldb_merge_hash(uint8_t *data, uint32_t ln, uint64_t hash)
+{
+	for (uint32_t i = 0; i < ln; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+/**
+ * @brief Locates the value compared by the merge policy in a record. Records lacking the key field are
+ * compared as a whole.
+ *
+ * @param table table struct config
+ * @param rec record
+ */
+void ldb_merge_field(struct ldb_table table, struct ldb_merge_record *rec)
+{
+	rec->field = rec->data;
+	rec->field_ln = rec->size;
+
+	if (table.merge != LDB_MERGE_LAST) return;
+
+	/* Leading bytes of fixed-length records */
+	if (table.rec_ln)
+	{
+		if (table.merge_field < rec->size) rec->field_ln = table.merge_field;
+		return;
+	}
+
+	/* CSV field of variable-length records */
+	uint8_t *field = rec->data;
+	uint8_t *end = rec->data + rec->size;
+	for (int i = 1; i < table.merge_field; i++)
+	{
+		field = memchr(field, ',', end - field);
+		if (!field) return;
+		field++;
+	}
+
+	uint8_t *field_end = memchr(field, ',', end - field);
+	rec->field = field;
+	rec->field_ln = (field_end ? field_end : end) - field;
+}
+
+/**
+ * @brief Checks if two records hold the same compared value
+ *
+ * @param a first record
+ * @param b second record
+ * @return true if they are equal
+ */
+bool ldb_merge_equal(struct ldb_merge_record *a, struct ldb_merge_record *b)
+{
+	if (a->hash != b->hash) return false;
+	if (a->subkey_ln != b->subkey_ln || a->field_ln != b->field_ln) return false;
+	if (a->subkey_ln && memcmp(a->subkey, b->subkey, a->subkey_ln)) return false;
+	return !memcmp(a->field, b->field, a->field_ln);
+}
+
+/**
+ * @brief Appends a record to the array of records
+ *
+ * @param table table struct config
+ * @param records pointer to the array of records
+ * @param count[in,out] number of records
+ * @param size[in,out] allocated records
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @param data record
+ * @param data_ln record length
+ */
+void ldb_merge_add(struct ldb_table table, struct ldb_merge_record **records, uint32_t *count, uint32_t *size, uint8_t *subkey, uint8_t subkey_ln, uint8_t *data, uint32_t data_ln)
+{
+	if (*count == *size)
+	{
+		*size *= 2;
+		*records = realloc(*records, *size * sizeof(struct ldb_merge_record));
+	}
+
+	struct ldb_merge_record *rec = *records + (*count)++;
+	rec->subkey = subkey;
+	rec->subkey_ln = subkey_ln;
+	rec->data = data;
+	rec->size = data_ln;
+	rec->keep = false;
+	ldb_merge_field(table, rec);
+	rec->hash = ldb_merge_hash(rec->field, rec->field_ln, ldb_merge_hash(subkey, subkey_ln, 0xcbf29ce484222325));
+}
+
+/**
+ * @brief Splits a record buffer into records. Nodes of fixed-length records are split into single records.
+ *
+ * @param table table struct config
+ * @param buffer record buffer
+ * @param count[out] number of records
+ * @return struct ldb_merge_record* array of records (to be freed by the caller)
+ */
+struct ldb_merge_record *ldb_merge_split(struct ldb_table table, struct ldb_record_buffer *buffer, uint32_t *count)
+{
+	uint32_t size = 1024;
+	struct ldb_merge_record *records = malloc(size * sizeof(struct ldb_merge_record));
+	*count = 0;
+
+	uint64_t ptr = 0;
+	while (ptr < buffer->ln)
+	{
+		uint8_t subkey_ln = buffer->data[ptr];
+		uint8_t *subkey = buffer->data + ptr + 1;
+		uint32_t data_ln = uint32_read(buffer->data + ptr + 1 + subkey_ln);
+		uint8_t *data = buffer->data + ptr + 1 + subkey_ln + 4;
+		ptr += 1 + subkey_ln + 4 + data_ln;
+
+		if (!table.rec_ln) ldb_merge_add(table, &records, count, &size, subkey, subkey_ln, data, data_ln);
+		else for (uint32_t i = 0; i + table.rec_ln <= data_ln; i += table.rec_ln)
+			ldb_merge_add(table, &records, count, &size, subkey, subkey_ln, data + i, table.rec_ln);
+	}
+
+	return records;
+}
+
+/**
+ * @brief Marks the records to be kept. Records are visited from the first for "dedup" and from the
+ * last for "upsert", so the first visited of each value is the one kept.
+ *
+ * @param table table struct config
+ * @param records array of records
+ * @param count number of records
+ */
+void ldb_merge_mark(struct ldb_table table, struct ldb_merge_record *records, uint32_t count)
+{
+	/* Hash set of record numbers (plus one), at most half full */
+	uint32_t slots = 16;
+	while (slots < count * 2) slots *= 2;
+	uint32_t *set = calloc(slots, sizeof(uint32_t));
+
+	for (uint32_t n = 0; n < count; n++)
+	{
+		uint32_t r = (table.merge == LDB_MERGE_LAST) ? count - 1 - n : n;
+		struct ldb_merge_record *rec = records + r;
+
+		uint32_t slot = rec->hash & (slots - 1);
+		bool found = false;
+		while (set[slot])
+		{
+			if (ldb_merge_equal(records + set[slot] - 1, rec))
+			{
+				found = true;
+				break;
+			}
+			slot = (slot + 1) & (slots - 1);
+		}
+
+		if (!found)
+		{
+			set[slot] = r + 1;
+			rec->keep = true;
+		}
+	}
+
+	free(set);
+}
+
+/**
+ * @brief Fetches the records for key applying the merge policy of the table. Surviving records are passed
+ * to the handler one by one, in their original order.
+ *
+ * @param sector Optional: Pointer to a LDB sector allocated in memory
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records passed to the handler
+ */
+uint32_t ldb_merge_fetch(uint8_t *sector, struct ldb_table table, uint8_t *key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	/* Buffer the list as stored */
+	struct ldb_table stored = table;
+	stored.merge = LDB_MERGE_ALL;
+	struct ldb_record_buffer buffer = {NULL, 0, 0};
+	ldb_fetch_list(sector, stored, key, skip_subkey, NULL, ldb_multi_collect_handler, &buffer);
+	if (!buffer.ln)
+	{
+		free(buffer.data);
+		return 0;
+	}
+
+	uint32_t count = 0;
+	struct ldb_merge_record *records = ldb_merge_split(table, &buffer, &count);
+	ldb_merge_mark(table, records, count);
+
+	/* Pass surviving records to the handler */
+	uint32_t passed = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		struct ldb_merge_record *rec = records + i;
+		if (!rec->keep) continue;
+		if (ldb_record_handler(key, rec->subkey, rec->subkey_ln, rec->data, rec->size, passed++, void_ptr)) break;
+	}
+
+	free(records);
+	free(buffer.data);
+	return passed;
+}
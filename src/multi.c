@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/multi.c
+ *
+ * Concurrent lookup of a key across several tables
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file multi.c
+  * @date 18 Oct 2026
+  * @brief Looks up the same key in several tables at once
+
+  * Each table is read by its own thread into a private buffer. Once all reads are finished, the records
+  * are passed to the handler table by table, so the handler does not need to be thread safe and the
+  * latency of the lookup is that of the slowest table.
+
+  * BUFFERED RECORD STRUCTURE
+  * S = 8-bit subkey length
+  * K = subkey
+  * L = 32-bit record length
+  * D = record (or node of fixed-length records)
+  * @see https://github.com/scanoss/ldb/blob/master/src/multi.c
+  */
+
+/**
+ * @brief Handler function for ldb_fetch_recordset_multi. Appends records to a record buffer
+ * 
+ * @param key Not used
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @param data record
+ * @param size record length
+ * @param iteration Not used
+ * @param ptr pointer to the ldb_record_buffer
+ * @return false always
+ */
+bool ldb_multi_collect_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr)
+{
+	struct ldb_record_buffer *buffer = ptr;
+	uint64_t needed = buffer->ln + 1 + subkey_ln + 4 + size;
+
+	if (needed > buffer->size)
+	{
+		buffer->size = needed * 2;
+		buffer->data = realloc(buffer->data, buffer->size);
+	}
+
+	uint8_t *out = buffer->data + buffer->ln;
+	*out = subkey_ln;
+	if (subkey_ln) memcpy(out + 1, subkey, subkey_ln);
+	uint32_write(out + 1 + subkey_ln, size);
+	memcpy(out + 1 + subkey_ln + 4, data, size);
+	buffer->ln = needed;
+
+	return false;
+}
+
+/**
+ * @brief Thread function reading the records of a job
+ * 
+ * @param ptr pointer to the ldb_multi_job
+ * @return NULL
+ */
+void *ldb_multi_fetch(void *ptr)
+{
+	struct ldb_multi_job *job = ptr;
+	ldb_fetch_recordset_filter(NULL, job->table, job->key, job->skip_subkey, job->filter, job->offset, job->limit, ldb_multi_collect_handler, &job->records);
+	return NULL;
+}
+
+/**
+ * @brief Fetches the records for key from several tables concurrently. Records are then passed to the handler
+ * in table order, with the void_ptr given for their table, which tells the handler where they come from.
+ * 
+ * @param tables array of tables
+ * @param table_count number of tables (up to LDB_MAX_MULTI)
+ * @param key key
+ * @param skip_subkey true for skip the subkey
+ * @param filter Optional: record filter
+ * @param offset number of records to skip in each table
+ * @param limit maximum number of records per table (0 for no limit)
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptrs array with the pointer to be passed to the handler for each table
+ * @return uint32_t The total number of records passed to the handler
+ */
+uint32_t ldb_fetch_recordset_multi(struct ldb_table *tables, int table_count, uint8_t *key, bool skip_subkey, struct ldb_filter *filter, uint32_t offset, uint32_t limit, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void **void_ptrs)
+{
+	if (table_count > LDB_MAX_MULTI) table_count = LDB_MAX_MULTI;
+
+	struct ldb_multi_job *jobs = calloc(table_count, sizeof(struct ldb_multi_job));
+
+	/* Start one read per table */
+	for (int i = 0; i < table_count; i++)
+	{
+		jobs[i].table = tables[i];
+		jobs[i].key = key;
+		jobs[i].skip_subkey = skip_subkey;
+		jobs[i].filter = filter;
+		jobs[i].offset = offset;
+		jobs[i].limit = limit;
+		jobs[i].started = !pthread_create(&jobs[i].thread, NULL, ldb_multi_fetch, jobs + i);
+
+		/* Read in this thread if no thread could be started */
+		if (!jobs[i].started) ldb_multi_fetch(jobs + i);
+	}
+
+	uint32_t records = 0;
+
+	/* Pass records to the handler, table by table */
+	for (int i = 0; i < table_count; i++)
+	{
+		if (jobs[i].started) pthread_join(jobs[i].thread, NULL);
+
+		uint64_t ptr = 0;
+		int iteration = 0;
+		while (ptr < jobs[i].records.ln)
+		{
+			uint8_t *record = jobs[i].records.data + ptr;
+			int subkey_ln = *record;
+			uint32_t size = uint32_read(record + 1 + subkey_ln);
+			ptr += 1 + subkey_ln + 4 + size;
+			records++;
+
+			if (ldb_record_handler(key, record + 1, subkey_ln, record + 1 + subkey_ln + 4, size, iteration++, void_ptrs[i])) break;
+		}
+		free(jobs[i].records.data);
+	}
+
+	free(jobs);
+	return records;
+}
@@ -184,6 +184,13 @@ bool mz_list_handler(struct mz_job *job)
 		printf("%s [OK] %lu bytes\n", job->md5, job->data_ln);
 	}
 
+	/* Verification is a maintenance task */
+	if (job->check_only)
+	{
+		ldb_throttle_read(job->ln);
+		ldb_throttle_cpu();
+	}
+
 	return true;
 }
 
@@ -722,6 +729,7 @@ bool mz_check(char *path)
 		return false;
 	}
 	close(mzfile);
+	ldb_throttle_read(size);
 
 	/* Recurse mz contents */
 	uint64_t ptr = 0;
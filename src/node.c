@@ -42,6 +42,19 @@
   * R: Data record
   * s = is a 16-bit record size (omitted when record size is fixed)
   * d = is the data record
+
+  * Packed tables (intern, frontcode and/or compress, variable-sized records only) keep TS as the size of the
+  * node data, which follows as:
+  * ZS = is the 32-bit size of the stored data, which is packed when ZS is below TS, or as is
+  * Z = is the node data (K, GS and R), front-coded and then zlib compressed as set for the table
+  * When ZS has the LDB_DICT_NODE flag, Z starts with the 32-bit size of the interned node data (see dict.c),
+  * which is what is front-coded and compressed
+
+  * Front-coded node data replaces each K and GS with:
+  * P = is the 8-bit number of leading bytes K shares with the K before it in the node (0 for the first)
+  * k = is the rest of K
+  * n = is a varint with the number of records in the group
+  * and each record size (s) with a varint, followed by the record data. P and k are omitted for 32-bit keys.
   * @see https://github.com/scanoss/ldb/blob/master/src/node.c
   */
 
@@ -80,6 +93,394 @@ void ldb_load_node(struct ldb_recordset *rs)
 	rs->node[rs->node_ln] = 0;
 
 }
+
+struct ldb_node_buffers
+{
+	uint8_t *data[3];
+	uint32_t size[3];
+};
+
+pthread_key_t ldb_node_buffer_key;
+pthread_once_t ldb_node_buffer_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Frees the node buffers of a thread when it exits
+ *
+ * @param ptr node buffers
+ */
+void ldb_node_buffer_free(void *ptr)
+{
+	struct ldb_node_buffers *buffers = ptr;
+	for (int i = 0; i < 3; i++) free(buffers->data[i]);
+	free(buffers);
+}
+
+/**
+ * @brief Creates the key for the per-thread node buffers
+ */
+void ldb_node_buffer_init(void)
+{
+	pthread_key_create(&ldb_node_buffer_key, ldb_node_buffer_free);
+}
+
+/**
+ * @brief Returns a node buffer of the calling thread, which is reused by every packed node read by the
+ * thread. Buffer 0 holds the node data unpacked from a sector in memory, valid until the next read, buffer 1
+ * the inflated front-coded data and buffer 2 the interned data while unpacking. Buffers grow as needed and
+ * are freed when their thread exits.
+ *
+ * @param n buffer number (0 to 2)
+ * @param size minimum size
+ * @return uint8_t* buffer
+ */
+uint8_t *ldb_node_buffer(int n, uint32_t size)
+{
+	pthread_once(&ldb_node_buffer_once, ldb_node_buffer_init);
+	struct ldb_node_buffers *buffers = pthread_getspecific(ldb_node_buffer_key);
+	if (!buffers)
+	{
+		buffers = calloc(1, sizeof(struct ldb_node_buffers));
+		pthread_setspecific(ldb_node_buffer_key, buffers);
+	}
+
+	if (buffers->size[n] < size)
+	{
+		if (size < LDB_MAX_REC_LN + 1) size = LDB_MAX_REC_LN + 1;
+		free(buffers->data[n]);
+		buffers->data[n] = malloc(size);
+		buffers->size[n] = size;
+	}
+	return buffers->data[n];
+}
+
+/**
+ * @brief Checks if the nodes of a table are packed (interned, front-coded and/or compressed)
+ *
+ * @param table table struct config
+ * @return true for compress, frontcode or intern tables with variable-length records
+ */
+bool ldb_node_packed(struct ldb_table table)
+{
+	return (table.compress || table.frontcode || table.intern) && !table.rec_ln;
+}
+
+/**
+ * @brief Returns the length of the data following a record size in node data
+ *
+ * @param rec_ln record size (s)
+ * @param interned node data is interned
+ * @return uint32_t data length, which is a reference for LDB_DICT_REF records in interned data
+ */
+uint32_t ldb_node_body_ln(uint16_t rec_ln, bool interned)
+{
+	return (interned && rec_ln == LDB_DICT_REF) ? LDB_PTR_LN : rec_ln;
+}
+
+/**
+ * @brief Front-codes node data: each subkey is stored as the number of leading bytes it shares with the
+ * previous subkey in the node followed by the rest of it, and GS and record sizes are replaced by varints
+ * with the number of records in the group and the size of each record.
+ *
+ * @param table table struct config
+ * @param data node data (K, GS and R)
+ * @param size node data size
+ * @param out[out] front-coded data, with room for twice the node data
+ * @param interned node data is interned (records of LDB_DICT_REF size hold a reference)
+ * @return uint32_t front-coded size, zero if the node data is malformed
+ */
+uint32_t ldb_node_frontcode(struct ldb_table table, uint8_t *data, uint32_t size, uint8_t *out, bool interned)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint8_t *last = NULL;
+	uint32_t ptr = 0;
+	uint32_t out_ln = 0;
+
+	while (ptr < size)
+	{
+		if (ptr + subkey_ln + 2 > size) return 0;
+
+		/* K (32-bit key tables have none) */
+		if (subkey_ln)
+		{
+			uint8_t *subkey = data + ptr;
+			int prefix = 0;
+			if (last) while (prefix < subkey_ln && subkey[prefix] == last[prefix]) prefix++;
+			last = subkey;
+
+			out[out_ln++] = prefix;
+			memcpy(out + out_ln, subkey + prefix, subkey_ln - prefix);
+			out_ln += subkey_ln - prefix;
+		}
+
+		/* GS */
+		uint32_t end = ptr + subkey_ln + 2 + uint16_read(data + ptr + subkey_ln);
+		ptr += subkey_ln + 2;
+		if (end > size) return 0;
+
+		uint32_t records = 0;
+		for (uint32_t rec = ptr; rec < end; rec += 2 + ldb_node_body_ln(uint16_read(data + rec), interned)) records++;
+		out_ln += varint_write(out + out_ln, records);
+
+		while (ptr < end)
+		{
+			if (ptr + 2 > end) return 0;
+			uint16_t rec_ln = uint16_read(data + ptr);
+			uint32_t body_ln = ldb_node_body_ln(rec_ln, interned);
+			ptr += 2;
+			if (ptr + body_ln > end) return 0;
+
+			out_ln += varint_write(out + out_ln, rec_ln);
+			memcpy(out + out_ln, data + ptr, body_ln);
+			out_ln += body_ln;
+			ptr += body_ln;
+		}
+	}
+	return out_ln;
+}
+
+/**
+ * @brief Restores front-coded node data
+ *
+ * @param table table struct config
+ * @param in front-coded data
+ * @param in_ln front-coded size
+ * @param out[out] node data
+ * @param size node data size (TS, or the interned size)
+ * @param interned node data is interned
+ * @return true if exactly size bytes of node data were restored
+ */
+bool ldb_node_frontdecode(struct ldb_table table, uint8_t *in, uint32_t in_ln, uint8_t *out, uint32_t size, bool interned)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint8_t *in_end = in + in_ln;
+	uint8_t *last = NULL;
+	uint32_t out_ln = 0;
+
+	while (in < in_end)
+	{
+		if (out_ln + subkey_ln + 2 > size) return false;
+
+		/* K */
+		if (subkey_ln)
+		{
+			int prefix = *in++;
+			if (prefix > subkey_ln || (prefix && !last)) return false;
+			if (in + subkey_ln - prefix > in_end) return false;
+
+			memcpy(out + out_ln, last, prefix);
+			memcpy(out + out_ln + prefix, in, subkey_ln - prefix);
+			in += subkey_ln - prefix;
+			last = out + out_ln;
+		}
+
+		/* GS is restored once the records are */
+		uint32_t gs_ptr = out_ln + subkey_ln;
+		out_ln = gs_ptr + 2;
+
+		uint32_t records;
+		int ln = varint_read(in, in_end, &records);
+		if (!ln) return false;
+		in += ln;
+
+		uint32_t group_start = out_ln;
+		for (uint32_t r = 0; r < records; r++)
+		{
+			uint32_t rec_ln;
+			int ln = varint_read(in, in_end, &rec_ln);
+			if (!ln) return false;
+			in += ln;
+			if (rec_ln > LDB_MAX_REC_LN) return false;
+			uint32_t body_ln = ldb_node_body_ln(rec_ln, interned);
+			if (in + body_ln > in_end || out_ln + 2 + body_ln > size) return false;
+
+			uint16_write(out + out_ln, rec_ln);
+			memcpy(out + out_ln + 2, in, body_ln);
+			out_ln += 2 + body_ln;
+			in += body_ln;
+		}
+
+		if (out_ln - group_start > LDB_MAX_REC_LN) return false;
+		uint16_write(out + gs_ptr, out_ln - group_start);
+	}
+	return out_ln == size;
+}
+
+/**
+ * @brief Encodes node data as set for the table: front-coded and then compressed
+ *
+ * @param table table struct config
+ * @param data node data
+ * @param size node data size
+ * @param interned node data is interned
+ * @param out[out] encoded data, malloc'ed (or data itself when it is not encoded)
+ * @return uint32_t encoded size, zero on error
+ */
+uint32_t ldb_node_encode(struct ldb_table table, uint8_t *data, uint32_t size, bool interned, uint8_t **out)
+{
+	uint8_t *packed = data;
+	uLongf packed_ln = size;
+
+	if (table.frontcode)
+	{
+		packed = malloc(2 * (uint64_t) size + 1);
+		packed_ln = ldb_node_frontcode(table, data, size, packed, interned);
+	}
+
+	if (table.compress && packed_ln)
+	{
+		uLongf zdata_ln = compressBound(packed_ln);
+		uint8_t *zdata = malloc(zdata_ln);
+		if (compress(zdata, &zdata_ln, packed, packed_ln) != Z_OK) zdata_ln = 0;
+		if (packed != data) free(packed);
+		packed = zdata;
+		packed_ln = zdata_ln;
+	}
+
+	*out = packed;
+	return packed_ln;
+}
+
+/**
+ * @brief Packs node data in place, prefixing it with ZS. Record bodies are interned (when the table
+ * dictionary is open for writing), and the data is then front-coded and compressed, as set for the table.
+ * Data which does not shrink is kept as is.
+ *
+ * @param table table struct config
+ * @param data node data, with room for 4 more bytes
+ * @param size node data size
+ * @return uint32_t size taken by ZS and the stored data
+ */
+uint32_t ldb_node_pack(struct ldb_table table, uint8_t *data, uint32_t size)
+{
+	/* Interned data is stored instead, preceded by its size */
+	uint8_t *interned = table.intern ? malloc(size) : NULL;
+	uint32_t interned_ln = interned ? ldb_dict_intern(table, data, size, interned) : 0;
+	uint8_t *src = interned_ln ? interned : data;
+	uint32_t src_ln = interned_ln ? interned_ln : size;
+
+	uint8_t *packed = NULL;
+	uint32_t packed_ln = ldb_node_encode(table, src, src_ln, interned_ln, &packed);
+
+	if (!packed_ln || packed_ln >= src_ln)
+	{
+		if (packed != src) free(packed);
+		packed = src;
+		packed_ln = src_ln;
+	}
+
+	uint32_t zs = packed_ln;
+	if (interned_ln)
+	{
+		memcpy(data + 8, packed, packed_ln);
+		uint32_write(data + 4, interned_ln);
+		zs = LDB_DICT_NODE | (4 + packed_ln);
+		packed_ln += 4;
+	}
+	else memmove(data + 4, packed, packed_ln);
+
+	if (packed != src) free(packed);
+	free(interned);
+
+	uint32_write(data, zs);
+	return 4 + packed_ln;
+}
+
+/**
+ * @brief Decodes front-coded and/or compressed node data. Data of the same size is as is.
+ *
+ * @param table table struct config
+ * @param zdata encoded data
+ * @param zdata_ln encoded size
+ * @param data[out] node data
+ * @param size node data size
+ * @param interned node data is interned
+ * @return true if the node data was restored
+ */
+bool ldb_node_decode(struct ldb_table table, uint8_t *zdata, uint32_t zdata_ln, uint8_t *data, uint32_t size, bool interned)
+{
+	if (zdata_ln == size)
+	{
+		memcpy(data, zdata, size);
+		return true;
+	}
+	if (zdata_ln > size) return false;
+
+	if (!table.frontcode)
+	{
+		uLongf data_ln = size;
+		return uncompress(data, &data_ln, zdata, zdata_ln) == Z_OK && data_ln == size;
+	}
+
+	/* Front-coded data takes up to twice the node data */
+	if (table.compress)
+	{
+		uLongf packed_ln = 2 * (uint64_t) size;
+		uint8_t *packed = ldb_node_buffer(1, packed_ln);
+		if (uncompress(packed, &packed_ln, zdata, zdata_ln) != Z_OK) return false;
+		zdata = packed;
+		zdata_ln = packed_ln;
+	}
+
+	return ldb_node_frontdecode(table, zdata, zdata_ln, data, size, interned);
+}
+
+/**
+ * @brief Restores the data of a packed node
+ *
+ * @param table table struct config
+ * @param zdata stored data
+ * @param zs ZS, the stored data size with the LDB_DICT_NODE flag
+ * @param data[out] node data
+ * @param size node data size (TS)
+ * @return true if the node data was restored
+ */
+bool ldb_node_unpack(struct ldb_table table, uint8_t *zdata, uint32_t zs, uint8_t *data, uint32_t size)
+{
+	uint32_t zdata_ln = zs & ~LDB_DICT_NODE;
+	if (!(zs & LDB_DICT_NODE)) return ldb_node_decode(table, zdata, zdata_ln, data, size, false);
+
+	/* Interned data is decoded first, then its references are resolved */
+	if (zdata_ln < 4) return false;
+	uint32_t interned_ln = uint32_read(zdata);
+	if (interned_ln >= size) return false;
+
+	uint8_t *interned = zdata + 4;
+	if (zdata_ln - 4 != interned_ln)
+	{
+		interned = ldb_node_buffer(2, interned_ln);
+		if (!ldb_node_decode(table, zdata + 4, zdata_ln - 4, interned, interned_ln, true)) return false;
+	}
+
+	return ldb_dict_resolve(table, interned, interned_ln, data, size);
+}
+
+/**
+ * @brief Reads the data of a node from the sector, right after its header. Packed nodes are unpacked.
+ *
+ * @param table table struct config
+ * @param ldb_sector open sector, positioned after the node header
+ * @param size node data size (in bytes)
+ * @param out[out] node data
+ * @return uint32_t bytes taken by the node data in the sector, zero on error
+ */
+uint32_t ldb_node_data_read(struct ldb_table table, FILE *ldb_sector, uint32_t size, uint8_t *out)
+{
+	if (!ldb_node_packed(table)) return fread(out, 1, size, ldb_sector) == size ? size : 0;
+
+	uint8_t header[4];
+	if (fread(header, 1, 4, ldb_sector) != 4) return 0;
+	uint32_t zs = uint32_read(header);
+	uint32_t zdata_ln = zs & ~LDB_DICT_NODE;
+	if (zdata_ln > size) return 0;
+
+	/* Data which did not shrink is read as is */
+	if (zs == size) return fread(out, 1, size, ldb_sector) == size ? 4 + size : 0;
+
+	uint8_t *zdata = ldb_node_buffer(0, zdata_ln);
+	if (fread(zdata, 1, zdata_ln, ldb_sector) != zdata_ln) return 0;
+	return ldb_node_unpack(table, zdata, zs, out, size) ? 4 + zdata_ln : 0;
+}
+
 /**
  * @brief Writes data into a node and updates pointers
  * 
@@ -118,8 +519,11 @@ void ldb_node_write (struct ldb_table table, FILE *ldb_sector, uint8_t *key, uin
 		exit(EXIT_FAILURE);
 	}
 
-	/* Allocate memory for new node, plus LN(5), NN(5) and TS(4 max)*/
-	uint8_t *node = malloc(LDB_MAX_NODE_LN + LDB_PTR_LN + LDB_PTR_LN + table.ts_ln);
+	/* A new list adds the key to the presence bitmap */
+	if (list == 0) ldb_bitmap_log(table, key, true);
+
+	/* Allocate memory for new node, plus LN(5), NN(5), TS(4 max) and ZS(4) */
+	uint8_t *node = malloc(LDB_MAX_NODE_LN + LDB_PTR_LN + LDB_PTR_LN + table.ts_ln + 4);
 	uint64_t node_ptr = 0;
 
 	/* LN: A new list starts with a pointer to the last node (which is itself after LN(5)) */
@@ -149,6 +553,7 @@ void ldb_node_write (struct ldb_table table, FILE *ldb_sector, uint8_t *key, uin
 	else ldb_error("E060 Unsupported node_length size (must be 2 or 4 bytes)");
 
 	/* K: Write the key after the 4th byte (if needed) */
+	uint64_t data_ptr = node_ptr;
 	if (table.key_ln > LDB_KEY_LN)
 	{
 		memcpy(node + node_ptr, key + LDB_KEY_LN, table.key_ln - LDB_KEY_LN);
@@ -159,6 +564,9 @@ void ldb_node_write (struct ldb_table table, FILE *ldb_sector, uint8_t *key, uin
 	memcpy(node + node_ptr, data, dataln);
 	node_ptr += dataln;
 
+	/* ZS: Pack the node data */
+	if (ldb_node_packed(table)) node_ptr = data_ptr + ldb_node_pack(table, node + data_ptr, node_ptr - data_ptr);
+
 	/* Write actual node */
 	if (node_ptr != fwrite(node, 1, node_ptr, ldb_sector)) ldb_error("E058 Error writing node");
 
@@ -168,6 +576,46 @@ void ldb_node_write (struct ldb_table table, FILE *ldb_sector, uint8_t *key, uin
 	free(node);
 }
 
+/**
+ * @brief Reads the header of a node from the given location (ptr) for a 32-bit key, without reading its data.
+ * If ptr is set to zero, the location is obtained from the sector map.
+ * 
+ * @param sector Optional: Pointer to a LDB sector allocated in memory. If NULL the function will use ldb_sector
+ * @param table  table struct config
+ * @param ldb_sector A file descriptor to the LDB sector. If sector is not NULL, this parameter is ignored.
+ * @param ptr If ptr is set to zero, the location is obtained from the sector map
+ * @param key key of the associated table
+ * @param node_size[out] node size from the header (number of records for fixed-length records)
+ * @return uint64_t The addr of the next node
+ */
+uint64_t ldb_node_skip(uint8_t *sector, struct ldb_table table, FILE *ldb_sector, uint64_t ptr, uint8_t *key, uint32_t *node_size)
+{
+	*node_size = 0;
+
+	/* If pointer is zero, get the list location from the map */
+	if (ptr == 0)
+	{
+		if (sector) ptr = uint40_read(sector + ldb_map_pointer_pos(key));
+		else ptr = ldb_list_pointer(ldb_sector, key);
+		if (ptr == 0) return 0;
+		ptr += LDB_PTR_LN;
+	}
+
+	/* Read NN(5) and TS(2/4) */
+	uint8_t header[LDB_PTR_LN + 4];
+	if (sector) memcpy(header, sector + ptr, LDB_PTR_LN + table.ts_ln);
+	else
+	{
+		fseeko64(ldb_sector, ptr, SEEK_SET);
+		if (!fread(header, 1, LDB_PTR_LN + table.ts_ln, ldb_sector)) return 0;
+	}
+
+	if (table.ts_ln == 2) *node_size = uint16_read(header + LDB_PTR_LN);
+	else *node_size = uint32_read(header + LDB_PTR_LN);
+
+	return uint40_read(header);
+}
+
 /**
  * @brief Reads a node from the given location (ptr) for a 32-bit key. If ptr is set to zero, the location is
  * obtained from the sector map. The function returns a pointer to the next node, which is zero if it 
@@ -235,10 +683,34 @@ uint64_t ldb_node_read(uint8_t *sector, struct ldb_table table, FILE *ldb_sector
 	if (actual_size)
 	{
 
-		if (table.rec_ln) if (actual_size > 64800) actual_size = 64800; //TODO: EXPAND?
+		if (table.rec_ln) if (actual_size > LDB_MAX_FIXED_NODE_LN) actual_size = LDB_MAX_FIXED_NODE_LN;
+
+		/* Packed nodes are unpacked into out, or into the thread node buffer when reading from memory */
+		if (ldb_node_packed(table))
+		{
+			bool unpacked = true;
+			if (sector)
+			{
+				uint8_t *zdata = buffer + LDB_PTR_LN + table.ts_ln;
+				uint32_t zs = uint32_read(zdata);
+				*out = zdata + 4;
+				if (zs != actual_size)
+				{
+					*out = ldb_node_buffer(0, actual_size);
+					unpacked = ldb_node_unpack(table, zdata + 4, zs, *out, actual_size);
+				}
+			}
+			else unpacked = ldb_node_data_read(table, ldb_sector, actual_size, *out);
+
+			if (!unpacked)
+			{
+				printf("Warning: cannot unpack LDB node\n");
+				actual_size = 0;
+			}
+		}
 
 		/* Return the entire node */
-		if (sector)
+		else if (sector)
 		{
 			*out = buffer + LDB_PTR_LN + table.ts_ln;
 		}
@@ -257,7 +729,8 @@ uint64_t ldb_node_read(uint8_t *sector, struct ldb_table table, FILE *ldb_sector
 }
 
 /**
- * @brief Unlinks a first node found for the given table and key
+ * @brief Unlinks a first node found for the given table and key. Subkeys cannot be unlinked from
+ * packed nodes, as they are not stored in the clear.
  * 
  * @param table Configuration of a table
  * @param key The key of the table
@@ -267,15 +740,25 @@ void ldb_node_unlink (struct ldb_table table, uint8_t *key)
 
 	uint16_t subkeyln = table.key_ln - LDB_KEY_LN;
 
+	if (subkeyln && ldb_node_packed(table))
+	{
+		printf("E088 Subkeys cannot be unlinked from packed table %s/%s\n", table.db, table.table);
+		return;
+	}
+
 	/* Open sector */
 	FILE *ldb_sector = ldb_open(table, key, "r+");
 
 	if (ldb_sector)
 	{
+		/* Unlinking does not change the sector size, drop its index */
+		if (table.index) ldb_index_drop(table, key);
 
 		/* For a 32-bit key, we simply wipe out the map pointer, killing the entire list */
 		if (table.key_ln == LDB_KEY_LN)
 		{
+			ldb_bitmap_log(table, key, false);
+
 			/* Move pointer to the map pointer */
 			fseeko64(ldb_sector, ldb_map_pointer_pos(key), SEEK_SET);
 
@@ -377,6 +860,71 @@ void ldb_node_unlink (struct ldb_table table, uint8_t *key)
 	if (ldb_sector) fclose(ldb_sector);
 }
 
+/**
+ * @brief Overwrites in place the fixed-length records of a list which start with the same *match_ln* bytes
+ * as *record*. Records keep their position, so the sector size, map, bitmap and index are not affected.
+ * 
+ * @param table Configuration of a table (with fixed-length records)
+ * @param key The key of the table
+ * @param record new record (table.rec_ln bytes)
+ * @param match_ln length of the leading field used to locate the records
+ * @return int number of records updated
+ */
+int ldb_node_update(struct ldb_table table, uint8_t *key, uint8_t *record, int match_ln)
+{
+	uint16_t subkey_ln = table.key_ln - LDB_KEY_LN;
+	int updated = 0;
+
+	if (!table.rec_ln || match_ln < 1 || match_ln > table.rec_ln) return 0;
+
+	/* Open sector */
+	FILE *ldb_sector = ldb_open(table, key, "r+");
+	if (!ldb_sector) return 0;
+
+	uint64_t list = ldb_list_pointer(ldb_sector, key);
+	uint64_t node = list ? list + LDB_PTR_LN : 0;
+
+	while (node)
+	{
+		uint32_t records = 0;
+		uint64_t next = ldb_node_skip(NULL, table, ldb_sector, node, key, &records);
+
+		if (records)
+		{
+			/* K and R: read the subkey and the records of the node */
+			uint32_t data_ln = subkey_ln + records * table.rec_ln;
+			uint64_t data_ptr = node + LDB_PTR_LN + table.ts_ln;
+			uint8_t *data = malloc(data_ln);
+
+			if (fread(data, 1, data_ln, ldb_sector) == data_ln)
+			{
+				if (!subkey_ln || !memcmp(data, key + LDB_KEY_LN, subkey_ln))
+				{
+					for (uint32_t i = 0; i < records; i++)
+					{
+						uint8_t *rec = data + subkey_ln + i * table.rec_ln;
+						if (memcmp(rec, record, match_ln)) continue;
+
+						/* Positional write of the record, unless it is unchanged */
+						if (memcmp(rec, record, table.rec_ln))
+						{
+							fseeko64(ldb_sector, data_ptr + subkey_ln + i * table.rec_ln, SEEK_SET);
+							if (fwrite(record, 1, table.rec_ln, ldb_sector) != table.rec_ln)
+								ldb_error("E058 Error writing node");
+						}
+						updated++;
+					}
+				}
+			}
+			free(data);
+		}
+		node = next;
+	}
+
+	fclose(ldb_sector);
+	return updated;
+}
+
 /**
  * @brief Validates a node checking for the dataset size.
  * 
@@ -30,106 +30,410 @@
   */
 
 /**
- * @brief Recurses all records in *table* for *key* and calls the provided handler funcion in each iteration, passing
- * subkey, subkey length, fetched data, length and iteration number. This function acts on the .ldb for the
- * provided *key*, but can also work from memory, if a pointer to a *sector* is provided (not NULL)
+ * @brief Passes the records contained in a node to the handler function. For fixed-length records
+ * the entire node is passed in a single call.
+ * 
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param node node data
+ * @param node_size size of the node data
+ * @param records[in,out] number of records passed to the handler so far
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return true if the handler requested to stop
+ */
+bool ldb_fetch_node_records(struct ldb_table table, uint8_t *key, bool skip_subkey, uint8_t *node, uint32_t node_size, uint32_t *records, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	uint8_t subkey_ln = table.key_ln - LDB_KEY_LN;
+	bool done = false;
+
+	/* Pass entire node (fixed record length) to handler */
+	if (table.rec_ln) return ldb_record_handler(key, NULL, 0 , node, node_size, (*records)++, void_ptr);
+
+	/* Extract and pass variable-size records to handler */
+	if (!ldb_validate_node(node, node_size, subkey_ln)) return false;
+
+	/* Extract datasets from node */
+	uint32_t node_ptr = 0;
+
+	while (node_ptr < node_size && !done)
+	{
+		/* Get subkey */
+		uint8_t *subkey = node + node_ptr;
+		node_ptr += subkey_ln;
+
+		/* Get recordset length */
+		int dataset_size = uint16_read(node + node_ptr);
+		node_ptr += 2;
+
+		/* Compare subkey */
+		bool key_matched = true;
+		if (!skip_subkey) if (subkey_ln) key_matched = (memcmp(subkey, key + 4, subkey_ln) == 0);
+
+		if (key_matched)
+		{
+			/* Extract records from dataset */
+			uint32_t dataset_ptr = 0;
+			while (dataset_ptr < dataset_size)
+			{
+				uint8_t *dataset = node + node_ptr;
+
+				/* Get record length */
+				int record_size = uint16_read(dataset + dataset_ptr);
+				dataset_ptr += 2;
+
+				/* We drop records longer than the desired limit */
+				if (record_size + 32 < LDB_MAX_REC_LN)
+					done = ldb_record_handler(key, subkey, subkey_ln, dataset + dataset_ptr, record_size, (*records)++, void_ptr);
+
+				/* Move pointer to end of record */
+				dataset_ptr += record_size;
+			}
+		}
+		/* Move pointer to end of dataset */
+		node_ptr += dataset_size;
+	}
+
+	return done;
+}
+
+/**
+ * @brief Walks the list for *key* in its sector, passing its records to the handler. When a range is given,
+ * nodes of fixed-length records which fall entirely before the offset are skipped by reading their header only.
  * 
  * @param sector Optional: Pointer to a LDB sector allocated in memory. If NULL the function will use tha table struct and key to open the ldb
+ * @param open_sector Optional: sector already open, used instead of opening the ldb when sector is NULL
  * @param table table struct config
  * @param key key of the associated table
  * @param skip_subkey true for skip the subkey
+ * @param range Optional: filter, offset and limit (the handler must be ldb_fetch_range_handler)
  * @param ldb_record_handler Handler to print the data
  * @param void_ptr This pointer is passed to the handler function
+ * @param done[out] true if the handler requested to stop
  * @return uint32_t The number of records found
  */
-uint32_t ldb_fetch_recordset(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+uint32_t ldb_fetch_sector_list(uint8_t *sector, FILE *open_sector, struct ldb_table table, uint8_t* key, bool skip_subkey, struct ldb_fetch_range *range, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr, bool *done)
 {
-	FILE *ldb_sector = NULL;
+	uint64_t next = 0;
+	uint32_t indexed = 0;
+
+	/* A valid sector index locates the records for a full key, or tells that there are none */
+	if (!sector && table.index && !skip_subkey)
+		if (!ldb_index_lookup(table, key, &next, &indexed)) return 0;
+
+	FILE *ldb_sector = open_sector;
 	uint8_t *node;
 
 	/* Open sector from disk (if *sector is not provided) */
 	if (sector) node = sector;
 	else
 	{
-		ldb_sector = ldb_open(table, key, "r+");
+		if (!ldb_sector) ldb_sector = ldb_open(table, key, "r+");
 		if (!ldb_sector) return 0;
 		node = calloc(LDB_MAX_REC_LN + 1, 1);
 	}
 
-	uint64_t next = 0;
 	uint32_t node_size = 0;
-	uint32_t node_ptr;
-	uint8_t subkey_ln = table.key_ln - LDB_KEY_LN;
 
 	uint32_t records = 0;
-	bool done = false;
+	*done = false;
 
 	do
 	{
+		/* Skip nodes before the requested offset without reading their records */
+		if (range && table.rec_ln && !range->filter && range->skipped < range->offset)
+		{
+			uint64_t following = ldb_node_skip(sector, table, ldb_sector, next, key, &node_size);
+			if (node_size <= range->offset - range->skipped)
+			{
+				range->skipped += node_size;
+				next = following;
+				continue;
+			}
+		}
+
 		/* Read node */
 		next = ldb_node_read(sector, table, ldb_sector, next, key, &node_size, &node, 0);
 		if (!node_size && !next) break; // reached end of list
 
-		/* Pass entire node (fixed record length) to handler */
-		if (table.rec_ln) done = ldb_record_handler(key, NULL, 0 , node, node_size, records++, void_ptr);
+		/* Pass records to handler */
+		*done = ldb_fetch_node_records(table, key, skip_subkey, node, node_size, &records, ldb_record_handler, void_ptr);
 
-		/* Extract and pass variable-size records to handler */
-		else
-		{
-			if (!ldb_validate_node(node, node_size, subkey_ln)) continue;
+		/* Indexed records are contiguous, there is no need to read the rest of the list */
+		if (indexed && records >= indexed) break;
 
-			/* Extract datasets from node */
-			node_ptr = 0;
-
-			while (node_ptr < node_size && !done)
-			{
-				/* Get subkey */
-				uint8_t *subkey = node + node_ptr;
-				node_ptr += subkey_ln;
-
-				/* Get recordset length */
-				int dataset_size = uint16_read(node + node_ptr);
-				node_ptr += 2;
-
-				/* Compare subkey */
-				bool key_matched = true;
-				if (!skip_subkey) if (subkey_ln) key_matched = (memcmp(subkey, key + 4, subkey_ln) == 0);
-
-				if (key_matched)
-				{
-					/* Extract records from dataset */
-					uint32_t dataset_ptr = 0;
-					while (dataset_ptr < dataset_size)
-					{
-						uint8_t *dataset = node + node_ptr;
-
-						/* Get record length */
-						int record_size = uint16_read(dataset + dataset_ptr);
-						dataset_ptr += 2;
-
-						/* We drop records longer than the desired limit */
-						if (record_size + 32 < LDB_MAX_REC_LN)
-							done = ldb_record_handler(key, subkey, subkey_ln, dataset + dataset_ptr, record_size, records++, void_ptr);
-
-						/* Move pointer to end of record */
-						dataset_ptr += record_size;
-					}
-				}
-				/* Move pointer to end of dataset */
-				node_ptr += dataset_size;
-			}
-		}
-	} while (next && !done);
+	} while (next && !*done);
 
 	if (!sector)
 	{
 		free(node);
-		fclose(ldb_sector);
+		if (!open_sector) fclose(ldb_sector);
+	}
+
+	return records;
+}
+
+/**
+ * @brief Walks the list for *key*, passing its records to the handler. Inserts still in the write-ahead log
+ * of the table follow the records in the sector.
+ * 
+ * @param sector Optional: Pointer to a LDB sector allocated in memory. If NULL the function will use tha table struct and key to open the ldb
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param range Optional: filter, offset and limit (the handler must be ldb_fetch_range_handler)
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records found
+ */
+uint32_t ldb_fetch_list(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, struct ldb_fetch_range *range, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	/* Duplicated or superseded records are dropped according to the table merge policy */
+	if (table.merge != LDB_MERGE_ALL) return ldb_merge_fetch(sector, table, key, skip_subkey, ldb_record_handler, void_ptr);
+
+	/* Frozen tables are served from their immutable sectors */
+	if (!sector && table.frozen) return ldb_frozen_fetch(table, key, skip_subkey, ldb_record_handler, void_ptr);
+
+	/* The log cannot be applied while the list is read */
+	int wal_fd = (!sector && table.wal) ? ldb_wal_read_lock(table) : -1;
+
+	bool done = false;
+	uint32_t records = ldb_fetch_sector_list(sector, NULL, table, key, skip_subkey, range, ldb_record_handler, void_ptr, &done);
+
+	if (wal_fd >= 0)
+	{
+		if (!done) ldb_wal_fetch(table, wal_fd, key, skip_subkey, &records, ldb_record_handler, void_ptr);
+		ldb_wal_read_unlock(wal_fd);
+	}
+
+	return records;
+}
+
+/**
+ * @brief Like ldb_fetch_recordset, but reads the list from a sector which is already open, so that keys
+ * visited in sector order open each sector once (see ldb_join_lookup)
+ * 
+ * @param ldb_sector open sector, or NULL if the sector does not exist
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records found
+ */
+uint32_t ldb_fetch_open_list(FILE *ldb_sector, struct ldb_table table, uint8_t* key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	/* Merge policies and frozen tables read the list their own way */
+	if (table.merge != LDB_MERGE_ALL || table.frozen) return ldb_fetch_list(NULL, table, key, skip_subkey, NULL, ldb_record_handler, void_ptr);
+
+	int wal_fd = table.wal ? ldb_wal_read_lock(table) : -1;
+
+	bool done = false;
+	uint32_t records = 0;
+	if (ldb_sector) records = ldb_fetch_sector_list(NULL, ldb_sector, table, key, skip_subkey, NULL, ldb_record_handler, void_ptr, &done);
+
+	if (wal_fd >= 0)
+	{
+		if (!done) ldb_wal_fetch(table, wal_fd, key, skip_subkey, &records, ldb_record_handler, void_ptr);
+		ldb_wal_read_unlock(wal_fd);
 	}
 
 	return records;
 }
 
+/**
+ * @brief Recurses all records in *table* for *key* and calls the provided handler funcion in each iteration, passing
+ * subkey, subkey length, fetched data, length and iteration number. This function acts on the .ldb for the
+ * provided *key*, but can also work from memory, if a pointer to a *sector* is provided (not NULL)
+ * 
+ * @param sector Optional: Pointer to a LDB sector allocated in memory. If NULL the function will use tha table struct and key to open the ldb
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records found
+ */
+uint32_t ldb_fetch_recordset(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	return ldb_fetch_list(sector, table, key, skip_subkey, NULL, ldb_record_handler, void_ptr);
+}
+
+/**
+ * @brief Checks a record against a filter. CSV fields are located with memchr, and records which do not
+ * contain the wanted value anywhere are rejected with a single memmem scan.
+ * 
+ * @param filter filter
+ * @param data record
+ * @param size record length
+ * @return true if the record matches
+ */
+bool ldb_filter_match(struct ldb_filter *filter, uint8_t *data, uint32_t size)
+{
+	/* Byte range equality */
+	if (filter->type == LDB_FILTER_BYTES)
+	{
+		if (filter->position + filter->value_ln > size) return false;
+		return !memcmp(data + filter->position, filter->value, filter->value_ln);
+	}
+
+	if (filter->value_ln && !memmem(data, size, filter->value, filter->value_ln)) return false;
+
+	/* Locate CSV field */
+	uint8_t *field = data;
+	uint8_t *end = data + size;
+	for (uint32_t i = 1; i < filter->position; i++)
+	{
+		field = memchr(field, ',', end - field);
+		if (!field) return false;
+		field++;
+	}
+
+	uint8_t *field_end = memchr(field, ',', end - field);
+	uint32_t field_ln = (field_end ? field_end : end) - field;
+
+	if (filter->type == LDB_FILTER_FIELD_EQUALS && field_ln != filter->value_ln) return false;
+	if (field_ln < filter->value_ln) return false;
+	return !memcmp(field, filter->value, filter->value_ln);
+}
+
+/**
+ * @brief Passes records to the range handler, dropping those before the offset and stopping at the limit
+ * 
+ * @param range pointer to the ldb_fetch_range struct
+ * @param key key
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @param data record (or fixed-length records)
+ * @param size data length
+ * @param count number of records in data
+ * @return true if the limit was reached or the handler requested to stop
+ */
+bool ldb_fetch_range_pass(struct ldb_fetch_range *range, uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, uint32_t count)
+{
+	uint32_t first = 0;
+
+	/* Drop records before the offset */
+	if (range->skipped < range->offset)
+	{
+		first = range->offset - range->skipped;
+		if (first > count) first = count;
+		range->skipped += first;
+	}
+
+	/* Keep up to limit */
+	uint32_t wanted = count - first;
+	if (range->limit && wanted > range->limit - range->passed) wanted = range->limit - range->passed;
+	if (!wanted) return (range->limit && range->passed >= range->limit);
+
+	bool done = false;
+	if (range->rec_ln)
+		done = range->handler(key, subkey, subkey_ln, data + first * range->rec_ln, wanted * range->rec_ln, range->calls++, range->ptr);
+	else
+		done = range->handler(key, subkey, subkey_ln, data, size, range->calls++, range->ptr);
+
+	range->passed += wanted;
+	return done || (range->limit && range->passed >= range->limit);
+}
+
+/**
+ * @brief Handler function for ldb_fetch_recordset_filter. Drops records not matching the filter, drops the
+ * records before the offset and stops once the limit is reached. Nodes of fixed-length records are passed
+ * in runs of consecutive wanted records.
+ * 
+ * @param key key
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @param data record (or node of fixed-length records)
+ * @param size data length
+ * @param iteration Not used
+ * @param ptr pointer to the ldb_fetch_range struct
+ * @return true if the limit was reached or the handler requested to stop
+ */
+bool ldb_fetch_range_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr)
+{
+	struct ldb_fetch_range *range = ptr;
+
+	if (!range->rec_ln)
+	{
+		if (range->filter) if (!ldb_filter_match(range->filter, data, size)) return false;
+		return ldb_fetch_range_pass(range, key, subkey, subkey_ln, data, size, 1);
+	}
+
+	uint32_t count = size / range->rec_ln;
+	if (!range->filter) return ldb_fetch_range_pass(range, key, subkey, subkey_ln, data, size, count);
+
+	/* Pass runs of matching fixed-length records */
+	uint32_t run_start = 0;
+	uint32_t run = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (ldb_filter_match(range->filter, data + i * range->rec_ln, range->rec_ln))
+		{
+			if (!run) run_start = i;
+			run++;
+		}
+		else if (run)
+		{
+			if (ldb_fetch_range_pass(range, key, subkey, subkey_ln, data + run_start * range->rec_ln, run * range->rec_ln, run)) return true;
+			run = 0;
+		}
+	}
+	if (run) return ldb_fetch_range_pass(range, key, subkey, subkey_ln, data + run_start * range->rec_ln, run * range->rec_ln, run);
+	return false;
+}
+
+/**
+ * @brief Like ldb_fetch_recordset, but only passes the records matching *filter*, from *offset* on, and
+ * stops reading the list once *limit* records have been passed to the handler. Records which do not match
+ * the filter never reach the handler.
+ * 
+ * @param sector Optional: Pointer to a LDB sector allocated in memory. If NULL the function will use tha table struct and key to open the ldb
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param filter Optional: record filter
+ * @param offset number of (matching) records to skip
+ * @param limit maximum number of records to pass to the handler (0 for no limit)
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records passed to the handler
+ */
+uint32_t ldb_fetch_recordset_filter(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, struct ldb_filter *filter, uint32_t offset, uint32_t limit, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	struct ldb_fetch_range range;
+	memset(&range, 0, sizeof(range));
+	range.offset = offset;
+	range.limit = limit;
+	range.rec_ln = table.rec_ln;
+	range.filter = filter;
+	range.handler = ldb_record_handler;
+	range.ptr = void_ptr;
+
+	ldb_fetch_list(sector, table, key, skip_subkey, &range, ldb_fetch_range_handler, &range);
+	return range.passed;
+}
+
+/**
+ * @brief Like ldb_fetch_recordset, but only passes records from *offset* on, and stops reading the list
+ * once *limit* records have been passed to the handler
+ * 
+ * @param sector Optional: Pointer to a LDB sector allocated in memory. If NULL the function will use tha table struct and key to open the ldb
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param offset number of records to skip
+ * @param limit maximum number of records to pass to the handler (0 for no limit)
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t The number of records passed to the handler
+ */
+uint32_t ldb_fetch_recordset_range(uint8_t *sector, struct ldb_table table, uint8_t* key, bool skip_subkey, uint32_t offset, uint32_t limit, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	return ldb_fetch_recordset_filter(sector, table, key, skip_subkey, NULL, offset, limit, ldb_record_handler, void_ptr);
+}
+
 /**
  * @brief Handler function for ldb_get_first_record
  * 
@@ -192,6 +496,252 @@ bool ldb_key_exists_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_
  */
 bool ldb_key_exists(struct ldb_table table, uint8_t *key)
 {
+	/* Use the key presence bitmap, if there is one. Inserts still in the write-ahead log are not in it */
+	if (table.bitmap && table.key_ln == LDB_KEY_LN)
+	{
+		int found = ldb_bitmap_key_exists(table, key);
+		if (found > 0 || (!found && !table.wal)) return found;
+	}
+
+	/* Use the sector index, if there is a valid one */
+	if (table.index)
+	{
+		uint64_t node = 0;
+		uint32_t records = 0;
+		int found = ldb_index_lookup(table, key, &node, &records);
+		if (found > 0 || (!found && !table.wal)) return found;
+	}
+
 	return (ldb_fetch_recordset(NULL, table, key, false, ldb_key_exists_handler, NULL) > 0);
 }
 
+
+/**
+ * @brief Counts the variable-length records contained in a node, without passing them to a handler.
+ * Datasets for other subkeys are skipped by their size.
+ * 
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @param node node data
+ * @param node_size size of the node data
+ * @return uint32_t number of records
+ */
+uint32_t ldb_count_node_records(struct ldb_table table, uint8_t *key, bool skip_subkey, uint8_t *node, uint32_t node_size)
+{
+	uint8_t subkey_ln = table.key_ln - LDB_KEY_LN;
+	if (!ldb_validate_node(node, node_size, subkey_ln)) return 0;
+
+	uint32_t records = 0;
+	uint32_t node_ptr = 0;
+
+	while (node_ptr < node_size)
+	{
+		uint8_t *subkey = node + node_ptr;
+		node_ptr += subkey_ln;
+
+		int dataset_size = uint16_read(node + node_ptr);
+		node_ptr += 2;
+
+		bool key_matched = true;
+		if (!skip_subkey) if (subkey_ln) key_matched = (memcmp(subkey, key + 4, subkey_ln) == 0);
+
+		/* Walk record sizes only, as ldb_fetch_node_records drops the same records */
+		if (key_matched)
+		{
+			uint32_t dataset_ptr = 0;
+			while (dataset_ptr < dataset_size)
+			{
+				int record_size = uint16_read(node + node_ptr + dataset_ptr);
+				dataset_ptr += 2 + record_size;
+				if (record_size + 32 < LDB_MAX_REC_LN) records++;
+			}
+		}
+		node_ptr += dataset_size;
+	}
+
+	return records;
+}
+
+/**
+ * @brief Handler function for counting records in frozen tables
+ * 
+ * @param key Not used
+ * @param subkey Not used
+ * @param subkey_ln Not used
+ * @param data Not used
+ * @param datalen Length of the record (or node of fixed-length records)
+ * @param iteration Not used
+ * @param ptr Pointer to the ldb_table, followed by the count
+ * @return false always
+ */
+bool ldb_count_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t datalen, int iteration, void *ptr)
+{
+	uint32_t *count = ptr;
+	if (count[1]) count[0] += datalen / count[1];
+	else count[0]++;
+	return false;
+}
+
+/**
+ * @brief Counts the records for key in an open sector, leaving out the write-ahead log. Nodes of fixed-length records are counted from their
+ * header (TS), while variable-length nodes are read but their records are not passed to any handler.
+ * 
+ * @param table table struct config
+ * @param ldb_sector open sector
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @return uint32_t number of records
+ */
+uint32_t ldb_count_sector_list(struct ldb_table table, FILE *ldb_sector, uint8_t *key, bool skip_subkey)
+{
+	/* A valid sector index holds the number of records for the key */
+	if (table.index && !skip_subkey)
+	{
+		uint64_t node = 0;
+		uint32_t indexed = 0;
+		int found = ldb_index_lookup(table, key, &node, &indexed);
+		if (found >= 0) return indexed;
+	}
+
+	/* The key presence bitmap tells if there is a list at all */
+	if (table.bitmap && table.key_ln == LDB_KEY_LN)
+		if (!ldb_bitmap_key_exists(table, key)) return 0;
+
+	if (!ldb_sector) return 0;
+
+	uint32_t records = 0;
+	uint32_t node_size = 0;
+	uint64_t next = 0;
+
+	if (table.rec_ln)
+	{
+		do
+		{
+			next = ldb_node_skip(NULL, table, ldb_sector, next, key, &node_size);
+			records += node_size;
+		} while (next);
+		return records;
+	}
+
+	uint8_t *node = calloc(LDB_MAX_REC_LN + 1, 1);
+	do
+	{
+		next = ldb_node_read(NULL, table, ldb_sector, next, key, &node_size, &node, 0);
+		if (!node_size && !next) break;
+		records += ldb_count_node_records(table, key, skip_subkey, node, node_size);
+	} while (next);
+	free(node);
+
+	return records;
+}
+
+/**
+ * @brief Counts the records for key in an open sector and in the write-ahead log of the table
+ * 
+ * @param table table struct config
+ * @param ldb_sector open sector
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey
+ * @return uint32_t number of records
+ */
+uint32_t ldb_count_list(struct ldb_table table, FILE *ldb_sector, uint8_t *key, bool skip_subkey)
+{
+	/* With a merge policy, only the records which would be fetched are counted */
+	if (table.merge != LDB_MERGE_ALL)
+	{
+		uint32_t count[2] = {0, 0};
+		return ldb_merge_fetch(NULL, table, key, skip_subkey, ldb_count_handler, count);
+	}
+
+	/* Frozen tables are counted from their immutable sectors */
+	if (table.frozen)
+	{
+		uint32_t count[2] = {0, table.rec_ln};
+		ldb_frozen_fetch(table, key, skip_subkey, ldb_count_handler, count);
+		return count[0];
+	}
+
+	int wal_fd = table.wal ? ldb_wal_read_lock(table) : -1;
+	uint32_t records = ldb_count_sector_list(table, ldb_sector, key, skip_subkey);
+
+	if (wal_fd >= 0)
+	{
+		uint32_t count[2] = {0, table.rec_ln};
+		uint32_t calls = 0;
+		ldb_wal_fetch(table, wal_fd, key, skip_subkey, &calls, ldb_count_handler, count);
+		records += count[0];
+		ldb_wal_read_unlock(wal_fd);
+	}
+
+	return records;
+}
+
+/**
+ * @brief Returns the number of records for key, without reading the records themselves
+ * 
+ * @param table table struct config
+ * @param key key of the associated table
+ * @param skip_subkey true for skip the subkey (count all records for the 32-bit key)
+ * @return uint32_t number of records
+ */
+uint32_t ldb_count_records(struct ldb_table table, uint8_t *key, bool skip_subkey)
+{
+	FILE *ldb_sector = table.frozen ? NULL : ldb_open(table, key, "r");
+	uint32_t records = ldb_count_list(table, ldb_sector, key, skip_subkey);
+	if (ldb_sector) fclose(ldb_sector);
+	return records;
+}
+
+/**
+ * @brief Compares two 64-bit values (for qsort)
+ * 
+ * @param a pointer to first value
+ * @param b pointer to second value
+ * @return int comparison result
+ */
+int ldb_count_cmp(const void *a, const void *b)
+{
+	uint64_t va = *(const uint64_t *) a;
+	uint64_t vb = *(const uint64_t *) b;
+	return (va > vb) - (va < vb);
+}
+
+/**
+ * @brief Counts the records for a batch of keys. Keys are visited in sector order, opening each sector once.
+ * 
+ * @param table table struct config
+ * @param keys array of keys
+ * @param key_ln length of the keys (either 4 bytes, or the table key length)
+ * @param count number of keys
+ * @param[out] records number of records for each key
+ */
+void ldb_count_records_batch(struct ldb_table table, uint8_t *keys, int key_ln, long count, uint32_t *records)
+{
+	/* Sort key positions by 32-bit key (high half) */
+	uint64_t *order = malloc(count * sizeof(uint64_t));
+	for (long i = 0; i < count; i++) order[i] = ((uint64_t) ldb_bitmap_key(keys + i * key_ln) << 32) | i;
+	qsort(order, count, sizeof(uint64_t), ldb_count_cmp);
+
+	FILE *ldb_sector = NULL;
+	int sector = -1;
+
+	for (long i = 0; i < count; i++)
+	{
+		long pos = order[i] & 0xffffffff;
+		uint8_t *key = keys + pos * key_ln;
+
+		/* Open each sector once */
+		if (!table.frozen && key[0] != sector)
+		{
+			if (ldb_sector) fclose(ldb_sector);
+			ldb_sector = ldb_open(table, key, "r");
+			sector = key[0];
+		}
+
+		records[pos] = ldb_count_list(table, ldb_sector, key, key_ln == LDB_KEY_LN);
+	}
+
+	if (ldb_sector) fclose(ldb_sector);
+	free(order);
+}
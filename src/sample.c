@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/sample.c
+ *
+ * Random sampling of records
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file sample.c
+  * @date 18 Oct 2026
+  * @brief Picks random records from a list or from a whole table, reading only the chosen nodes
+
+  * Nodes are walked to obtain the number of records in each node. For fixed-length records this is the node
+  * size in the header; variable-length nodes are read and their records counted. Each record is then an item
+  * of a reservoir sample of N records (Li's algorithm L, which skips ahead between chosen records so that the
+  * cost per node is constant). Chosen nodes are then read again in sector order.
+  * @see https://github.com/scanoss/ldb/blob/master/src/sample.c
+  */
+
+/**
+ * @brief Returns a random number in (0,1)
+ *
+ * @return double random number
+ */
+double ldb_sample_random(void)
+{
+	return (random() + 1.0) / (RAND_MAX + 2.0);
+}
+
+/**
+ * @brief Adds the records of a node to the reservoir
+ *
+ * @param sample sample data
+ * @param key list key
+ * @param node node location
+ * @param records number of records in the node
+ */
+void ldb_sample_node(struct ldb_sample *sample, uint8_t *key, uint64_t node, uint32_t records)
+{
+	uint64_t end = sample->seen + records;
+
+	while (sample->next < end)
+	{
+		struct ldb_sample_item *item = NULL;
+
+		/* Fill the reservoir first, then replace random items */
+		if (sample->count < sample->size) item = sample->items + sample->count++;
+		else item = sample->items + (random() % sample->size);
+
+		memcpy(item->key, key, LDB_KEY_LN);
+		item->node = node;
+		item->record = sample->next - sample->seen;
+
+		/* Skip to the next chosen record */
+		if (sample->count < sample->size) sample->next++;
+		else
+		{
+			sample->w *= exp(log(ldb_sample_random()) / sample->size);
+			sample->next += (uint64_t) floor(log(ldb_sample_random()) / log(1 - sample->w)) + 1;
+		}
+	}
+
+	sample->seen = end;
+}
+
+/**
+ * @brief Walks the nodes of a list, adding their records to the reservoir. Only node headers are read
+ * for fixed-length records.
+ *
+ * @param sample sample data
+ * @param table table struct config
+ * @param ldb_sector open sector
+ * @param key list key (the full key if sample->skip_subkey is false)
+ * @param list list pointer (from the map)
+ */
+void ldb_sample_list(struct ldb_sample *sample, struct ldb_table table, FILE *ldb_sector, uint8_t *key, uint64_t list)
+{
+	uint64_t node = list + LDB_PTR_LN;
+	uint32_t node_size = 0;
+
+	while (node)
+	{
+		uint64_t next = 0;
+		uint32_t records = 0;
+
+		if (table.rec_ln)
+		{
+			next = ldb_node_skip(NULL, table, ldb_sector, node, key, &node_size);
+			records = node_size;
+		}
+		else
+		{
+			next = ldb_node_read(NULL, table, ldb_sector, node, key, &node_size, &sample->node, 0);
+			if (node_size) records = ldb_count_node_records(table, key, sample->skip_subkey, sample->node, node_size);
+		}
+
+		if (records) ldb_sample_node(sample, key, node, records);
+		node = next;
+	}
+}
+
+/**
+ * @brief Walks all the lists in a sector, adding their nodes to the reservoir
+ *
+ * @param sample sample data
+ * @param table table struct config
+ * @param ldb_sector open sector
+ * @param k0 sector number
+ */
+void ldb_sample_sector(struct ldb_sample *sample, struct ldb_table table, FILE *ldb_sector, uint8_t k0)
+{
+	int chunk = 65536 * LDB_PTR_LN;
+	uint8_t *map = malloc(chunk);
+
+	/* Read the map in chunks of 65536 lists */
+	for (uint64_t map_ptr = 0; map_ptr < LDB_MAP_SIZE; map_ptr += chunk)
+	{
+		fseeko64(ldb_sector, map_ptr, SEEK_SET);
+		if (fread(map, 1, chunk, ldb_sector) != chunk) break;
+
+		for (int i = 0; i < chunk; i += LDB_PTR_LN)
+		{
+			uint64_t list = uint40_read(map + i);
+			if (!list) continue;
+
+			/* Map position is given by key bytes 1, 2 and 3 (see ldb_map_pointer_pos) */
+			uint64_t pos = (map_ptr + i) / LDB_PTR_LN;
+			uint8_t key[LDB_KEY_LN] = {k0, (pos >> 16) & 0xff, (pos >> 8) & 0xff, pos & 0xff};
+			ldb_sample_list(sample, table, ldb_sector, key, list);
+		}
+	}
+
+	free(map);
+}
+
+/**
+ * @brief Compares two sample items by sector and node (for qsort)
+ *
+ * @param a pointer to first item
+ * @param b pointer to second item
+ * @return int comparison result
+ */
+int ldb_sample_cmp(const void *a, const void *b)
+{
+	const struct ldb_sample_item *ia = a;
+	const struct ldb_sample_item *ib = b;
+	if (ia->key[0] != ib->key[0]) return ia->key[0] - ib->key[0];
+	if (ia->node != ib->node) return (ia->node > ib->node) ? 1 : -1;
+	return (ia->record > ib->record) - (ia->record < ib->record);
+}
+
+/**
+ * @brief Passes a chosen record of a node to the handler
+ *
+ * @param table table struct config
+ * @param key key (4 bytes, or the full key if skip_subkey is false)
+ * @param skip_subkey true for skip the subkey
+ * @param item chosen item
+ * @param node node data
+ * @param node_size node data length
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @param iteration iteration number
+ * @return true if a record was passed to the handler
+ */
+bool ldb_sample_record(struct ldb_table table, uint8_t *key, bool skip_subkey, struct ldb_sample_item *item, uint8_t *node, uint32_t node_size, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr, int iteration)
+{
+	/* Fixed-length records */
+	if (table.rec_ln)
+	{
+		if ((item->record + 1) * table.rec_ln > node_size) return false;
+		ldb_record_handler(key, NULL, 0, node + item->record * table.rec_ln, table.rec_ln, iteration, void_ptr);
+		return true;
+	}
+
+	/* Walk the records counted by ldb_count_node_records up to the chosen one */
+	if (!ldb_validate_node(node, node_size, table.key_ln - LDB_KEY_LN)) return false;
+
+	uint8_t subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint32_t node_ptr = 0;
+	uint32_t record = 0;
+
+	while (node_ptr < node_size)
+	{
+		uint8_t *subkey = node + node_ptr;
+		node_ptr += subkey_ln;
+		int dataset_size = uint16_read(node + node_ptr);
+		node_ptr += 2;
+
+		bool key_matched = true;
+		if (!skip_subkey) if (subkey_ln) key_matched = (memcmp(subkey, key + 4, subkey_ln) == 0);
+
+		if (key_matched)
+		{
+			uint32_t dataset_ptr = 0;
+			while (dataset_ptr < dataset_size)
+			{
+				int record_size = uint16_read(node + node_ptr + dataset_ptr);
+				dataset_ptr += 2;
+				if (record_size + 32 < LDB_MAX_REC_LN)
+				{
+					if (record++ == item->record)
+					{
+						ldb_record_handler(key, subkey, subkey_ln, node + node_ptr + dataset_ptr, record_size, iteration, void_ptr);
+						return true;
+					}
+				}
+				dataset_ptr += record_size;
+			}
+		}
+		node_ptr += dataset_size;
+	}
+	return false;
+}
+
+/**
+ * @brief Passes up to *n* randomly chosen records of a list (or of the whole table if *key* is NULL) to the handler.
+ * Each record is chosen at most once. Only node headers and the chosen nodes are read for fixed-length records;
+ * variable-length nodes are also read once to count their records.
+ *
+ * @param table table struct config
+ * @param key key, or NULL to sample the whole table
+ * @param skip_subkey true for skip the subkey
+ * @param n number of records wanted
+ * @param ldb_record_handler Handler to print the data
+ * @param void_ptr This pointer is passed to the handler function
+ * @return uint32_t number of records passed to the handler
+ */
+uint32_t ldb_sample(struct ldb_table table, uint8_t *key, bool skip_subkey, uint32_t n, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	if (!n) return 0;
+
+	struct ldb_sample sample;
+	memset(&sample, 0, sizeof(sample));
+	sample.size = n;
+	sample.items = calloc(n, sizeof(struct ldb_sample_item));
+	sample.w = 1;
+	sample.skip_subkey = skip_subkey || !key;
+	sample.node = calloc(LDB_MAX_REC_LN + 1, 1);
+	srandom(time(NULL) ^ getpid());
+
+	/* Walk node headers */
+	for (int k0 = 0; k0 < 256; k0++)
+	{
+		uint8_t k[LDB_KEY_LN] = {k0, 0, 0, 0};
+		if (key)
+		{
+			if (k0 != key[0]) continue;
+			memcpy(k, key, LDB_KEY_LN);
+		}
+
+		FILE *ldb_sector = ldb_open(table, k, "r");
+		if (!ldb_sector) continue;
+
+		if (key)
+		{
+			uint64_t list = ldb_list_pointer(ldb_sector, key);
+			if (list) ldb_sample_list(&sample, table, ldb_sector, key, list);
+		}
+		else ldb_sample_sector(&sample, table, ldb_sector, k0);
+
+		fclose(ldb_sector);
+	}
+
+	/* Read the chosen nodes, in sector order */
+	qsort(sample.items, sample.count, sizeof(struct ldb_sample_item), ldb_sample_cmp);
+
+	uint32_t records = 0;
+	FILE *ldb_sector = NULL;
+	int sector = -1;
+	uint8_t *node = sample.node;
+	uint64_t node_ptr = 0;
+	uint32_t node_size = 0;
+
+	for (uint32_t i = 0; i < sample.count; i++)
+	{
+		struct ldb_sample_item *item = sample.items + i;
+
+		/* Drop repeated picks */
+		if (i && !ldb_sample_cmp(item, item - 1)) continue;
+
+		if (item->key[0] != sector)
+		{
+			if (ldb_sector) fclose(ldb_sector);
+			ldb_sector = ldb_open(table, item->key, "r");
+			sector = item->key[0];
+			node_ptr = 0;
+		}
+		if (!ldb_sector) continue;
+
+		/* Read each chosen node once */
+		if (item->node != node_ptr)
+		{
+			ldb_node_read(NULL, table, ldb_sector, item->node, item->key, &node_size, &node, 0);
+			node_ptr = item->node;
+		}
+
+		uint8_t full_key[256];
+		memcpy(full_key, key ? key : item->key, sample.skip_subkey ? LDB_KEY_LN : table.key_ln);
+		if (ldb_sample_record(table, full_key, sample.skip_subkey, item, node, node_size, ldb_record_handler, void_ptr, records)) records++;
+	}
+
+	if (ldb_sector) fclose(ldb_sector);
+	free(node);
+	free(sample.items);
+	return records;
+}
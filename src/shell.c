@@ -73,10 +73,23 @@ void help()
 	printf("    Retrieves all records from db/table for the given hex key (ascii output)\n\n");
 	printf("select from DBNAME/TABLENAME key KEY csv hex N\n");
 	printf("    Retrieves all records from db/table for the given hex key (csv output, with first N bytes in hex)\n\n");
+	printf("select from DBNAME/TABLENAME key KEY ascii|hex|csv hex N limit N offset M\n");
+	printf("    Any select can be followed by limit and/or offset, to retrieve only N records after skipping M\n\n");
+	printf("select from DBNAME/TABLENAME key KEY ascii|hex|csv hex N where bytes N equals HEX\n");
+	printf("select from DBNAME/TABLENAME key KEY ascii|hex|csv hex N where field N equals|starts VALUE\n");
+	printf("    Any select can be filtered to records with the given bytes from position N (starting at 0),\n");
+	printf("    or with the given CSV field N (starting at 1) equal to or starting with VALUE\n\n");
+	printf("select from DBNAME/TABLE1,DBNAME/TABLE2,... key KEY ascii|hex|csv hex N\n");
+	printf("    Retrieves records for the given hex key from several tables at once, with the table as first field\n\n");
 	printf("delete from DBNAME/TABLENAME max LENGTH keys KEY_LIST\n");
 	printf("    Deletes all records for the given comma separated hex key list from the db/table. Max record length expected\n\n");
+	printf("delete from DBNAME/TABLENAME max LENGTH keys from PATH\n");
+	printf("    Deletes all records for the keys in PATH (either a hex key per line, or binary keys), which can be larger than memory\n\n");
 	printf("collate DBNAME/TABLENAME max LENGTH\n");
-	printf("    Collates all lists in a table, removing duplicates and records greater than LENGTH bytes\n\n");
+	printf("    Collates all lists in a table, removing duplicates and records greater than LENGTH bytes\n");
+	printf("    An interrupted collate resumes from the last collated sector\n\n");
+	printf("collate status DBNAME/TABLENAME\n");
+	printf("    Shows the progress of a collate, with an estimate of the remaining time\n\n");
 	printf("merge DBNAME/TABLENAME1 into DBNAME/TABLENAME2 max LENGTH\n");
 	printf("    Merges tables erasing tablename1 when done. Tables must have the same configuration\n\n");
 	printf("unlink list from DBNAME/TABLENAME key KEY\n");
@@ -86,7 +99,52 @@ void help()
 	printf("dump keys from DBNAME/TABLENAME\n");
 	printf("    Dumps a unique list of existing keys (binary output)\n\n");
 	printf("cat KEY from DBNAME/MZTABLE\n");
-	printf("		Shows the contents for KEY in MZ archive\n");
+	printf("		Shows the contents for KEY in MZ archive\n\n");
+	printf("alter table DBNAME/TABLENAME set|unset OPTION\n");
+	printf("    Enables or disables a table option. Options are:\n");
+	printf("    wal: inserts are appended to a write-ahead log and applied into the table in batches\n");
+	printf("    index: collate emits a sorted key index per sector, used by lookups (variable-length tables)\n");
+	printf("    bitmap: collate builds a key presence bitmap, kept in memory for key lookups (32-bit key tables)\n");
+	printf("    compress: nodes are stored zlib compressed (variable-length tables). Can only be changed on an\n");
+	printf("    empty table, existing data is converted by merging it into a new table with compress set\n");
+	printf("    frontcode: node subkeys are front-coded against the previous one, and group and record sizes are\n");
+	printf("    stored as varints (variable-length tables). Can be combined with compress, and changed as above\n");
+	printf("    intern: collate stores record bodies which repeat across the table once, in a table dictionary, and\n");
+	printf("    nodes refer to them (variable-length tables). Can be combined with the above, and changed as above\n");
+	printf("    dedup: lookups return only the first of identical records for a key\n");
+	printf("    upsert=N: lookups return only the last written record for each value of field N (CSV field starting\n");
+	printf("    at 1, or the first N bytes of fixed-length records)\n\n");
+	printf("wal replay DBNAME/TABLENAME\n");
+	printf("    Applies inserts pending in the write-ahead log into the table\n\n");
+	printf("freeze DBNAME/TABLENAME\n");
+	printf("    Converts a (collated) table into immutable sectors with a sorted key index. Frozen tables are read-only\n\n");
+	printf("count from DBNAME/TABLENAME key KEY\n");
+	printf("    Shows the number of records for the given hex key, without reading the records\n\n");
+	printf("count from DBNAME/TABLENAME keys KEY_LIST\n");
+	printf("    Shows the number of records for each key in the given comma separated hex key list\n\n");
+	printf("join DBNAME/TABLE_A key KEY field N with DBNAME/TABLE_B [threads N]\n");
+	printf("join DBNAME/TABLE_A key KEY bytes N with DBNAME/TABLE_B [threads N]\n");
+	printf("    Retrieves records from table A for the given hex key and looks up table B for the hex key in CSV field N\n");
+	printf("    (starting at 1) or the binary key at byte N (starting at 0) of each record. Shows KEY_A,RECORD_A,KEY_B,RECORD_B\n\n");
+	printf("sample N from DBNAME/TABLENAME [key KEY]\n");
+	printf("    Retrieves N random records from the table, or from the records for the given hex key\n\n");
+	printf("update DBNAME/TABLENAME key KEY match N hex RECORD\n");
+	printf("    Overwrites in place the records for KEY which start with the first N bytes of the hex RECORD\n");
+	printf("    (fixed-length tables only)\n\n");
+	printf("vacuum DBNAME/TABLENAME\n");
+	printf("    Compacts lists holding unlinked or deleted nodes, rewriting sectors with too much dead space\n\n");
+	printf("unlink keys from DBNAME/TABLENAME file PATH\n");
+	printf("    Unlinks the records for all the keys in PATH (either a hex key per line, or binary keys)\n\n");
+	printf("set OPTION=VALUE\n");
+	printf("    Changes a global option, applied within a second to running maintenance tasks (collate, merge,\n");
+	printf("    freeze, dump, mz verification). Options are (0 for no limit):\n");
+	printf("    read_mbps: read rate limit in MB/s\n");
+	printf("    write_mbps: write rate limit in MB/s\n");
+	printf("    cpu_share: maximum percentage of CPU time\n");
+	printf("    memory_mb: memory budget in MB for collate and bulk sector loads. Sectors which do not fit are mapped\n");
+	printf("    or streamed instead of read into memory, and a collate which cannot fit fails before it starts\n\n");
+	printf("show settings\n");
+	printf("    Lists the global options\n");
 
 }
 
@@ -163,10 +221,18 @@ bool execute(char *raw_command)
 			ldb_command_unlink_list(command);
 			break;
 
+		case COLLATE_STATUS:
+			ldb_command_collate_status(command);
+			break;
+
 		case COLLATE:
 			ldb_command_collate(command);
 			break;
 
+		case DELETE_FILE:
+			ldb_command_delete_file(command);
+			break;
+
 		case DELETE:
 			ldb_command_delete(command);
 			break;
@@ -195,6 +261,66 @@ bool execute(char *raw_command)
 			ldb_command_dump(command);
 			break;
 
+		case ALTER_TABLE_SET:
+			ldb_command_alter_table(command, true);
+			break;
+
+		case ALTER_TABLE_UNSET:
+			ldb_command_alter_table(command, false);
+			break;
+
+		case WAL_REPLAY:
+			ldb_command_wal_replay(command);
+			break;
+
+		case FREEZE:
+			ldb_command_freeze(command);
+			break;
+
+		case COUNT:
+			ldb_command_count(command, command_nr);
+			break;
+
+		case COUNT_KEYS:
+			ldb_command_count(command, command_nr);
+			break;
+
+		case JOIN_FIELD:
+			ldb_command_join(command, command_nr);
+			break;
+
+		case JOIN_BYTES:
+			ldb_command_join(command, command_nr);
+			break;
+
+		case SAMPLE_KEY:
+			ldb_command_sample(command, command_nr);
+			break;
+
+		case SAMPLE:
+			ldb_command_sample(command, command_nr);
+			break;
+
+		case UPDATE:
+			ldb_command_update(command);
+			break;
+
+		case VACUUM:
+			ldb_command_vacuum(command);
+			break;
+
+		case UNLINK_KEYS:
+			ldb_command_unlink_keys(command);
+			break;
+
+		case SET:
+			ldb_command_set(command);
+			break;
+
+		case SHOW_SETTINGS:
+			ldb_command_show_settings();
+			break;
+
 		default:
 			printf("E067 Command not implemented\n");
 			break;
@@ -256,7 +382,13 @@ int main()
 
 	if (!ldb_check_root()) return EXIT_FAILURE;
 
-	if (stdin_off) welcome();
+	if (stdin_off)
+	{
+		welcome();
+
+		/* Replay write-ahead logs left behind by previous sessions */
+		ldb_wal_recover();
+	}
 
 	do if (stdin_off) ldb_prompt();
 	while (stdin_handle() && stdin_off);
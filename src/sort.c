@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/sort.c
+ *
+ * Parallel sort
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file sort.c
+  * @date 18 Oct 2026
+  * @brief Sorts large arrays on a shared pool of worker threads
+
+  * Arrays with at least LDB_SORT_PARALLEL items are split into a chunk per worker. Chunks are sorted
+  * with qsort_r, and sorted runs are then merged pairwise, each round running its merges in parallel,
+  * through a scratch array of the same size. Smaller arrays are sorted with qsort_r directly.
+  * ldb_sort_unique also drops duplicates, which the last merge skips as it writes its output.
+
+  * The pool has a thread per CPU (up to LDB_SORT_THREADS) and is started on first use. It runs one
+  * batch of tasks at a time, and the caller waits for the whole batch.
+  * @see https://github.com/scanoss/ldb/blob/master/src/sort.c
+  */
+
+struct ldb_pool
+{
+	pthread_t threads[LDB_SORT_THREADS];
+	int size;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	void (*task) (void *);
+	uint8_t *args;    // task arguments
+	size_t arg_size;
+	int count;        // tasks in the batch
+	int next;         // next task to be taken
+	int pending;      // tasks not completed yet
+};
+
+struct ldb_sort_task
+{
+	uint8_t *src;
+	uint8_t *dst;
+	size_t size;
+	size_t start;     // first item of the run (or of the first run, when merging)
+	size_t items;     // items in the run (or in the first run)
+	size_t items_b;   // items in the second run (merging only)
+	bool unique;      // drop duplicates while merging
+	size_t written;   // items merged
+	int (*cmp) (const void *, const void *, void *);
+	void *arg;
+};
+
+struct ldb_pool ldb_pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .work = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};
+pthread_mutex_t ldb_run_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_once_t ldb_pool_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Pool worker, running tasks from the current batch
+ *
+ * @param ptr unused
+ * @return void* unused
+ */
+void *ldb_pool_worker(void *ptr)
+{
+	while (true)
+	{
+		pthread_mutex_lock(&ldb_pool.lock);
+		while (ldb_pool.next >= ldb_pool.count) pthread_cond_wait(&ldb_pool.work, &ldb_pool.lock);
+		void *arg = ldb_pool.args + ldb_pool.next++ * ldb_pool.arg_size;
+		pthread_mutex_unlock(&ldb_pool.lock);
+
+		ldb_pool.task(arg);
+
+		pthread_mutex_lock(&ldb_pool.lock);
+		if (!--ldb_pool.pending) pthread_cond_signal(&ldb_pool.done);
+		pthread_mutex_unlock(&ldb_pool.lock);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Starts the pool threads, one per CPU up to LDB_SORT_THREADS
+ */
+void ldb_pool_start(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int size = (cpus > LDB_SORT_THREADS) ? LDB_SORT_THREADS : (cpus > 0 ? cpus : 1);
+
+	for (int i = 0; i < size; i++)
+	{
+		if (pthread_create(&ldb_pool.threads[i], NULL, ldb_pool_worker, NULL)) break;
+		pthread_detach(ldb_pool.threads[i]);
+		ldb_pool.size++;
+	}
+}
+
+/**
+ * @brief Returns the number of pool workers, starting the pool if needed
+ *
+ * @return int workers
+ */
+int ldb_pool_size(void)
+{
+	pthread_once(&ldb_pool_once, ldb_pool_start);
+	return ldb_pool.size;
+}
+
+/**
+ * @brief Runs a batch of tasks on the pool and waits for all of them to complete
+ *
+ * @param task task function
+ * @param args array of task arguments
+ * @param arg_size size of each argument
+ * @param count number of tasks
+ */
+void ldb_pool_run(void (*task) (void *), void *args, size_t arg_size, int count)
+{
+	if (!count) return;
+	pthread_mutex_lock(&ldb_run_lock);
+	pthread_mutex_lock(&ldb_pool.lock);
+
+	ldb_pool.task = task;
+	ldb_pool.args = args;
+	ldb_pool.arg_size = arg_size;
+	ldb_pool.pending = count;
+	ldb_pool.next = 0;
+	ldb_pool.count = count;
+	pthread_cond_broadcast(&ldb_pool.work);
+
+	while (ldb_pool.pending) pthread_cond_wait(&ldb_pool.done, &ldb_pool.lock);
+
+	pthread_mutex_unlock(&ldb_pool.lock);
+	pthread_mutex_unlock(&ldb_run_lock);
+}
+
+/**
+ * @brief Sorts a run of items in place
+ *
+ * @param ptr sort task
+ */
+void ldb_sort_run(void *ptr)
+{
+	struct ldb_sort_task *t = ptr;
+	qsort_r(t->src + t->start * t->size, t->items, t->size, t->cmp, t->arg);
+}
+
+/**
+ * @brief Merges two consecutive sorted runs from src into dst, optionally dropping duplicates
+ *
+ * @param ptr sort task
+ */
+void ldb_sort_merge(void *ptr)
+{
+	struct ldb_sort_task *t = ptr;
+	uint8_t *a = t->src + t->start * t->size;
+	uint8_t *a_end = a + t->items * t->size;
+	uint8_t *b = a_end;
+	uint8_t *b_end = b + t->items_b * t->size;
+	uint8_t *first = t->dst + t->start * t->size;
+	uint8_t *out = first;
+
+	while (a < a_end || b < b_end)
+	{
+		uint8_t **next = &a;
+		if (a == a_end || (b < b_end && t->cmp(b, a, t->arg) < 0)) next = &b;
+
+		if (!t->unique || out == first || t->cmp(*next, out - t->size, t->arg))
+		{
+			memcpy(out, *next, t->size);
+			out += t->size;
+		}
+		*next += t->size;
+	}
+
+	t->written = (out - first) / t->size;
+}
+
+/**
+ * @brief Drops the duplicates from a sorted array, in place
+ *
+ * @param base array
+ * @param items number of items
+ * @param size item size
+ * @param cmp comparison function, as for qsort_r
+ * @param arg argument passed to cmp
+ * @return size_t number of unique items
+ */
+size_t ldb_unique(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg)
+{
+	if (!items) return 0;
+	uint8_t *data = base;
+	size_t unique = 1;
+
+	for (size_t i = 1; i < items; i++)
+	{
+		uint8_t *item = data + i * size;
+		if (!cmp(item, data + (unique - 1) * size, arg)) continue;
+		if (unique != i) memcpy(data + unique * size, item, size);
+		unique++;
+	}
+	return unique;
+}
+
+/**
+ * @brief Sorts an array, in parallel when it has at least LDB_SORT_PARALLEL items. Duplicates are
+ * dropped by the last merge, or after qsort_r when sorting serially.
+ *
+ * @param base array
+ * @param items number of items
+ * @param size item size
+ * @param cmp comparison function, as for qsort_r
+ * @param arg argument passed to cmp
+ * @param unique drop duplicates
+ * @return size_t number of items left
+ */
+size_t ldb_sort_items(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg, bool unique)
+{
+	int workers = (items < LDB_SORT_PARALLEL) ? 1 : ldb_pool_size();
+	uint8_t *tmp = (workers > 1) ? malloc(items * size) : NULL;
+
+	if (!tmp)
+	{
+		qsort_r(base, items, size, cmp, arg);
+		return unique ? ldb_unique(base, items, size, cmp, arg) : items;
+	}
+
+	/* Sort a chunk per worker */
+	struct ldb_sort_task tasks[LDB_SORT_THREADS];
+	size_t starts[LDB_SORT_THREADS + 1];
+	int runs = workers;
+	for (int i = 0; i <= runs; i++) starts[i] = items * i / runs;
+
+	for (int i = 0; i < runs; i++)
+	{
+		tasks[i] = (struct ldb_sort_task) {base, NULL, size, starts[i], starts[i + 1] - starts[i], 0, false, 0, cmp, arg};
+	}
+	ldb_pool_run(ldb_sort_run, tasks, sizeof(struct ldb_sort_task), runs);
+
+	/* Merge runs pairwise until there is one left, the last merge dropping duplicates */
+	uint8_t *src = base;
+	uint8_t *dst = tmp;
+	while (runs > 1)
+	{
+		int merges = 0;
+		for (int i = 0; i < runs; i += 2)
+		{
+			size_t start = starts[i];
+			size_t end = starts[(i + 2 <= runs) ? i + 2 : runs];
+			size_t mid = (i + 1 < runs) ? starts[i + 1] : end;
+			tasks[merges++] = (struct ldb_sort_task) {src, dst, size, start, mid - start, end - mid, unique && runs == 2, 0, cmp, arg};
+		}
+		ldb_pool_run(ldb_sort_merge, tasks, sizeof(struct ldb_sort_task), merges);
+
+		/* Remaining run boundaries */
+		int j = 0;
+		for (int i = 0; i < runs; i += 2) starts[j++] = starts[i];
+		starts[j] = items;
+		runs = merges;
+
+		uint8_t *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	size_t left = tasks[0].written;
+	if (src != base) memcpy(base, src, left * size);
+	free(tmp);
+	return left;
+}
+
+/**
+ * @brief Sorts an array, in parallel when it has at least LDB_SORT_PARALLEL items
+ *
+ * @param base array
+ * @param items number of items
+ * @param size item size
+ * @param cmp comparison function, as for qsort_r
+ * @param arg argument passed to cmp
+ */
+void ldb_sort(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg)
+{
+	ldb_sort_items(base, items, size, cmp, arg, false);
+}
+
+/**
+ * @brief Sorts an array and drops its duplicates (items comparing equal), which are skipped
+ * by the last merge instead of in a separate pass
+ *
+ * @param base array
+ * @param items number of items
+ * @param size item size
+ * @param cmp comparison function, as for qsort_r
+ * @param arg argument passed to cmp
+ * @return size_t number of unique items, left at the start of the array
+ */
+size_t ldb_sort_unique(void *base, size_t items, size_t size, int (*cmp) (const void *, const void *, void *), void *arg)
+{
+	return ldb_sort_items(base, items, size, cmp, arg, true);
+}
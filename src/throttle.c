@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/throttle.c
+ *
+ * I/O and CPU throttling for maintenance tasks
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file throttle.c
+  * @date 18 Oct 2026
+  * @brief Limits the read and write rates and the CPU share of maintenance tasks
+
+  * Bulk sector loads (collate, merge, freeze, dump), collate writes and mz verification pass through
+  * here. Reads and writes take tokens from a bucket refilled at read_mbps / write_mbps, holding up to
+  * one second of tokens, and sleep when it runs dry. With cpu_share set, the process sleeps whenever
+  * its CPU time exceeds that percentage of the elapsed time.
+
+  * Limits are global options (see ldb.cfg in the LDB root). The file is checked at most once a second
+  * and reloaded when it changes, so limits can be adjusted while a task is running. No limits are
+  * applied unless they are set.
+  * @see https://github.com/scanoss/ldb/blob/master/src/throttle.c
+  */
+
+struct ldb_throttle_bucket
+{
+	double rate;   // bytes per second, 0 for no limit
+	double tokens; // available bytes, negative when in debt
+	struct timespec last;
+};
+
+struct ldb_throttle_state
+{
+	struct ldb_throttle_bucket read;
+	struct ldb_throttle_bucket write;
+	int cpu_share;             // percentage, 0 for no limit
+	struct timespec cpu_start; // wall time at the start of the CPU accounting window
+	struct timespec cpu_used;  // process CPU time at the start of the window
+	long memory_mb;            // memory budget (see memory.c), 0 for none
+	time_t checked;            // last check of ldb.cfg
+	time_t mtime;
+};
+
+struct ldb_throttle_state ldb_throttle;
+pthread_mutex_t ldb_throttle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Returns the seconds elapsed between two times
+ *
+ * @param from start time
+ * @param to end time
+ * @return double seconds
+ */
+double ldb_throttle_elapsed(struct timespec *from, struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Sleeps for the given seconds
+ *
+ * @param seconds seconds
+ */
+void ldb_throttle_sleep(double seconds)
+{
+	if (seconds <= 0) return;
+	struct timespec t;
+	t.tv_sec = (time_t) seconds;
+	t.tv_nsec = (long) ((seconds - t.tv_sec) * 1e9);
+	while (nanosleep(&t, &t) && errno == EINTR);
+}
+
+/**
+ * @brief Resets a bucket to a new rate, starting empty
+ *
+ * @param bucket token bucket
+ * @param mbps rate in MB/s, 0 for no limit
+ */
+void ldb_throttle_bucket_set(struct ldb_throttle_bucket *bucket, long mbps)
+{
+	bucket->rate = (double) mbps * 1048576;
+	bucket->tokens = 0;
+	clock_gettime(CLOCK_MONOTONIC, &bucket->last);
+}
+
+/**
+ * @brief Reloads the limits and the memory budget if ldb.cfg has changed. Checks the file at most once a second.
+ * Must be called with ldb_throttle_lock held.
+ */
+void ldb_throttle_refresh(void)
+{
+	time_t now = time(NULL);
+	if (now == ldb_throttle.checked) return;
+	ldb_throttle.checked = now;
+
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/ldb.cfg", ldb_root);
+	struct stat st;
+	time_t mtime = stat(path, &st) ? 0 : st.st_mtime;
+	if (mtime == ldb_throttle.mtime) return;
+	ldb_throttle.mtime = mtime;
+
+	struct ldb_global_cfg cfg;
+	ldb_read_global_cfg(&cfg);
+	ldb_throttle_bucket_set(&ldb_throttle.read, cfg.read_mbps);
+	ldb_throttle_bucket_set(&ldb_throttle.write, cfg.write_mbps);
+	ldb_throttle.cpu_share = cfg.cpu_share;
+	ldb_throttle.memory_mb = cfg.memory_mb;
+	clock_gettime(CLOCK_MONOTONIC, &ldb_throttle.cpu_start);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ldb_throttle.cpu_used);
+}
+
+/**
+ * @brief Takes tokens from a bucket. Must be called with ldb_throttle_lock held.
+ *
+ * @param bucket token bucket
+ * @param bytes bytes read or written
+ * @return double seconds to sleep before going on
+ */
+double ldb_throttle_take(struct ldb_throttle_bucket *bucket, uint64_t bytes)
+{
+	if (!bucket->rate) return 0;
+
+	/* Refill, up to one second of tokens */
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	bucket->tokens += ldb_throttle_elapsed(&bucket->last, &now) * bucket->rate;
+	if (bucket->tokens > bucket->rate) bucket->tokens = bucket->rate;
+	bucket->last = now;
+
+	/* Debt is paid by sleeping, the next refill covers it */
+	bucket->tokens -= bytes;
+	return bucket->tokens < 0 ? -bucket->tokens / bucket->rate : 0;
+}
+
+/**
+ * @brief Accounts for bytes read by a maintenance task, sleeping if over the read limit
+ *
+ * @param bytes bytes read
+ */
+void ldb_throttle_read(uint64_t bytes)
+{
+	pthread_mutex_lock(&ldb_throttle_lock);
+	ldb_throttle_refresh();
+	double wait = ldb_throttle_take(&ldb_throttle.read, bytes);
+	pthread_mutex_unlock(&ldb_throttle_lock);
+	ldb_throttle_sleep(wait);
+}
+
+/**
+ * @brief Accounts for bytes written by a maintenance task, sleeping if over the write limit
+ *
+ * @param bytes bytes written
+ */
+void ldb_throttle_write(uint64_t bytes)
+{
+	pthread_mutex_lock(&ldb_throttle_lock);
+	ldb_throttle_refresh();
+	double wait = ldb_throttle_take(&ldb_throttle.write, bytes);
+	pthread_mutex_unlock(&ldb_throttle_lock);
+	ldb_throttle_sleep(wait);
+}
+
+/**
+ * @brief Sleeps if the process has used more than its CPU share since the last check. Meant to be called
+ * often by maintenance tasks, the share is measured over windows of at least 100ms.
+ */
+void ldb_throttle_cpu(void)
+{
+	pthread_mutex_lock(&ldb_throttle_lock);
+	ldb_throttle_refresh();
+
+	double wait = 0;
+	if (ldb_throttle.cpu_share && ldb_throttle.cpu_share < 100)
+	{
+		struct timespec wall, cpu;
+		clock_gettime(CLOCK_MONOTONIC, &wall);
+		double elapsed = ldb_throttle_elapsed(&ldb_throttle.cpu_start, &wall);
+
+		if (elapsed >= 0.1)
+		{
+			clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+			double used = ldb_throttle_elapsed(&ldb_throttle.cpu_used, &cpu);
+			wait = used * 100 / ldb_throttle.cpu_share - elapsed;
+
+			/* Start a new window, which begins after the sleep */
+			ldb_throttle.cpu_start = wall;
+			if (wait > 0)
+			{
+				ldb_throttle.cpu_start.tv_sec += (time_t) wait;
+				ldb_throttle.cpu_start.tv_nsec += (long) ((wait - (time_t) wait) * 1e9);
+				if (ldb_throttle.cpu_start.tv_nsec >= 1000000000)
+				{
+					ldb_throttle.cpu_start.tv_sec++;
+					ldb_throttle.cpu_start.tv_nsec -= 1000000000;
+				}
+			}
+			ldb_throttle.cpu_used = cpu;
+		}
+	}
+
+	pthread_mutex_unlock(&ldb_throttle_lock);
+	ldb_throttle_sleep(wait);
+}
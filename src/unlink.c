@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/unlink.c
+ *
+ * Batch unlink of keys
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file unlink.c
+  * @date 18 Oct 2026
+  * @brief Unlinks many keys at once, opening each sector once
+
+  * Keys are sorted, which groups them by sector and then by map slot. For 32-bit keys the map pointer
+  * is wiped, like ldb_list_unlink does. For longer keys each list is walked once for all the keys sharing
+  * its slot, and the subkeys of matching nodes (fixed-length records) or record groups (variable-length
+  * records) are wiped, like ldb_node_unlink does. All access is done with positional reads and writes on
+  * the sector descriptor, reading each node with a single call. Space is reclaimed by vacuum.
+  * Subkeys are stored inside packed nodes (compress, frontcode, intern) and cannot be wiped in place,
+  * so only 32-bit keys can be unlinked from packed tables. Delete handles the rest.
+
+  * KEY FILE
+  * Either text, with a hex key per line, or binary, with keys one after another.
+  * @see https://github.com/scanoss/ldb/blob/master/src/unlink.c
+  */
+
+/**
+ * @brief Loads a key file into memory. Text files are expected to hold a hex key per line, any other file is
+ * read as a sequence of binary keys.
+ *
+ * @param path key file path
+ * @param key_ln key length
+ * @param count[out] number of keys
+ * @return uint8_t* array of keys (to be freed by the caller), or NULL if the file is not valid
+ */
+uint8_t *ldb_load_key_file(char *path, int key_ln, uint64_t *count)
+{
+	*count = 0;
+	if (!ldb_file_exists(path)) return NULL;
+
+	uint64_t size = ldb_file_size(path);
+	FILE *fp = fopen(path, "rb");
+	if (!fp) return NULL;
+
+	uint8_t *data = malloc(size + 1);
+	if (fread(data, 1, size, fp) != size)
+	{
+		fclose(fp);
+		free(data);
+		return NULL;
+	}
+	fclose(fp);
+	data[size] = 0;
+
+	/* Text files only contain hex digits and line breaks */
+	bool text = size > 0;
+	for (uint64_t i = 0; i < size && text; i++)
+		if (!isxdigit(data[i]) && data[i] != '\n' && data[i] != '\r') text = false;
+
+	if (!text)
+	{
+		if (size % key_ln)
+		{
+			free(data);
+			return NULL;
+		}
+		*count = size / key_ln;
+		return data;
+	}
+
+	/* Convert hex lines in place */
+	uint64_t out = 0;
+	char *line = (char *) data;
+	while (*line)
+	{
+		int ln = strcspn(line, "\r\n");
+		if (ln)
+		{
+			if (ln != key_ln * 2)
+			{
+				free(data);
+				*count = 0;
+				return NULL;
+			}
+			ldb_hex_to_bin(line, ln, data + out);
+			out += key_ln;
+			(*count)++;
+		}
+		line += ln;
+		line += strspn(line, "\r\n");
+	}
+
+	return data;
+}
+
+/**
+ * @brief Searches a sorted array of keys for a subkey
+ *
+ * @param keys sorted keys sharing their first 32 bits
+ * @param count number of keys
+ * @param key_ln key length
+ * @param subkey subkey
+ * @return true if found
+ */
+bool ldb_unlink_find(uint8_t *keys, uint64_t count, int key_ln, uint8_t *subkey)
+{
+	int subkey_ln = key_ln - LDB_KEY_LN;
+	uint64_t low = 0;
+	uint64_t high = count;
+
+	while (low < high)
+	{
+		uint64_t mid = (low + high) / 2;
+		int cmp = memcmp(keys + mid * key_ln + LDB_KEY_LN, subkey, subkey_ln);
+		if (!cmp) return true;
+		if (cmp < 0) low = mid + 1;
+		else high = mid;
+	}
+	return false;
+}
+
+/**
+ * @brief Wipes the subkeys matching a group of keys in a list
+ *
+ * @param table table struct config
+ * @param fd sector descriptor
+ * @param keys sorted keys sharing their first 32 bits
+ * @param count number of keys
+ * @param node buffer for node data
+ * @return uint64_t number of nodes or record groups unlinked (none for packed tables)
+ */
+uint64_t ldb_unlink_list_keys(struct ldb_table table, int fd, uint8_t *keys, uint64_t count, uint8_t *node)
+{
+	if (ldb_node_packed(table)) return 0;
+
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint8_t empty[256] = {0};
+	uint8_t header[LDB_PTR_LN + 4];
+	uint64_t unlinked = 0;
+
+	if (pread(fd, header, LDB_PTR_LN, ldb_map_pointer_pos(keys)) != LDB_PTR_LN) return 0;
+	uint64_t ptr = uint40_read(header);
+	if (!ptr) return 0;
+	ptr += LDB_PTR_LN;
+
+	while (ptr)
+	{
+		/* NN and TS */
+		if (pread(fd, header, LDB_PTR_LN + table.ts_ln, ptr) != LDB_PTR_LN + table.ts_ln) break;
+		uint64_t next = uint40_read(header);
+		uint32_t size = (table.ts_ln == 2) ? uint16_read(header + LDB_PTR_LN) : uint32_read(header + LDB_PTR_LN);
+		uint64_t data_ptr = ptr + LDB_PTR_LN + table.ts_ln;
+
+		/* Fixed-length records share the node subkey */
+		if (size && table.rec_ln)
+		{
+			if (pread(fd, node, subkey_ln, data_ptr) != subkey_ln) break;
+			if (ldb_unlink_find(keys, count, table.key_ln, node))
+			{
+				if (pwrite(fd, empty, subkey_ln, data_ptr) != subkey_ln) ldb_error("E058 Error writing node");
+				unlinked++;
+			}
+		}
+
+		/* Variable-length nodes hold groups of records, each with its own subkey */
+		else if (size)
+		{
+			if (size > LDB_MAX_NODE_LN + LDB_MAX_REC_LN || pread(fd, node, size, data_ptr) != size) break;
+
+			uint32_t group = 0;
+			while (group + subkey_ln + 2 <= size)
+			{
+				if (ldb_unlink_find(keys, count, table.key_ln, node + group))
+				{
+					if (pwrite(fd, empty, subkey_ln, data_ptr + group) != subkey_ln) ldb_error("E058 Error writing node");
+					unlinked++;
+				}
+				group += subkey_ln + 2 + uint16_read(node + group + subkey_ln);
+			}
+		}
+
+		ptr = next;
+	}
+
+	return unlinked;
+}
+
+/**
+ * @brief Unlinks a batch of keys. Keys are sorted in place.
+ *
+ * @param table table struct config
+ * @param keys array of keys (table.key_ln bytes each)
+ * @param count number of keys
+ * @return uint64_t number of lists, nodes or record groups unlinked
+ */
+uint64_t ldb_unlink_keys(struct ldb_table table, uint8_t *keys, uint64_t count)
+{
+	if (ldb_node_packed(table) && table.key_ln > LDB_KEY_LN)
+	{
+		printf("E088 Subkeys cannot be unlinked from packed table %s/%s\n", table.db, table.table);
+		return 0;
+	}
+
+	int key_ln = table.key_ln;
+	uint64_t unlinked = 0;
+	uint8_t empty[LDB_PTR_LN] = {0};
+	uint8_t *node = malloc(LDB_MAX_NODE_LN + LDB_MAX_REC_LN);
+
+	ldb_cmp_width = key_ln;
+	qsort(keys, count, key_ln, ldb_collate_cmp);
+
+	uint64_t i = 0;
+	while (i < count)
+	{
+		/* Keys for the same sector */
+		uint8_t *key = keys + i * key_ln;
+		uint64_t last = i;
+		while (last < count && keys[last * key_ln] == key[0]) last++;
+
+		FILE *ldb_sector = ldb_open(table, key, "r");
+		if (ldb_sector)
+		{
+			fclose(ldb_sector);
+			ldb_sector = ldb_open(table, key, "r+");
+		}
+
+		if (ldb_sector)
+		{
+			int fd = fileno(ldb_sector);
+
+			while (i < last)
+			{
+				/* Keys for the same list */
+				uint8_t *list_key = keys + i * key_ln;
+				uint64_t list_last = i;
+				while (list_last < last && !memcmp(keys + list_last * key_ln, list_key, LDB_KEY_LN)) list_last++;
+
+				if (key_ln == LDB_KEY_LN)
+				{
+					if (pwrite(fd, empty, LDB_PTR_LN, ldb_map_pointer_pos(list_key)) != LDB_PTR_LN)
+						ldb_error("E058 Error writing node");
+					ldb_bitmap_log(table, list_key, false);
+					unlinked++;
+				}
+				else unlinked += ldb_unlink_list_keys(table, fd, list_key, list_last - i, node);
+
+				i = list_last;
+			}
+
+			fclose(ldb_sector);
+
+			/* Unlinking does not change the sector size, drop its index */
+			if (table.index) ldb_index_drop(table, key);
+		}
+
+		i = last;
+	}
+
+	free(node);
+	return unlinked;
+}
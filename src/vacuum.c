@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/vacuum.c
+ *
+ * Reclaims unlinked and deleted nodes without a full collate
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file vacuum.c
+  * @date 18 Oct 2026
+  * @brief Rewrites lists holding dead data, and entire sectors once dead space passes a threshold
+
+  * Unlinking wipes a map pointer or a subkey, leaving dead nodes and record groups behind. Dead data is
+  * made of zero-size nodes, and (for keys longer than 32 bits) of nodes or record groups with a zeroed
+  * subkey. Vacuum walks the lists of each sector and appends a compacted copy of those holding dead data,
+  * relinking the map to it. Records are neither sorted nor deduplicated, which is left to collate.
+
+  * Unreachable data (unlinked lists and the replaced copies) still takes space in the sector. When it
+  * exceeds LDB_VACUUM_REWRITE percent of the sector data, all live lists are copied into a .tmp sector
+  * which then replaces the .ldb sector.
+
+  * COMPACTED LIST STRUCTURE (in memory)
+  * L = 32-bit node data length
+  * R = 32-bit number of records (fixed-length records), otherwise zero
+  * D = node data (starting with its subkey)
+  * @see https://github.com/scanoss/ldb/blob/master/src/vacuum.c
+  */
+
+/**
+ * @brief Checks if a subkey has been wiped by an unlink
+ *
+ * @param subkey subkey
+ * @param subkey_ln subkey length
+ * @return true if the subkey is zeroed
+ */
+bool ldb_vacuum_dead_subkey(uint8_t *subkey, int subkey_ln)
+{
+	if (!subkey_ln) return false;
+	for (int i = 0; i < subkey_ln; i++) if (subkey[i]) return false;
+	return true;
+}
+
+/**
+ * @brief Appends a compacted node to a list buffer
+ *
+ * @param list list buffer
+ * @param data node data
+ * @param data_ln node data length
+ * @param records number of fixed-length records, otherwise zero
+ */
+void ldb_vacuum_add_node(struct ldb_record_buffer *list, uint8_t *data, uint32_t data_ln, uint32_t records)
+{
+	uint64_t needed = list->ln + 8 + data_ln;
+	if (needed > list->size)
+	{
+		list->size = needed * 2;
+		list->data = realloc(list->data, list->size);
+	}
+
+	uint32_write(list->data + list->ln, data_ln);
+	uint32_write(list->data + list->ln + 4, records);
+	memcpy(list->data + list->ln + 8, data, data_ln);
+	list->ln = needed;
+}
+
+/**
+ * @brief Keeps the record groups of a variable-length node which have not been unlinked
+ *
+ * @param table table struct config
+ * @param node node data
+ * @param node_ln node data length
+ * @param out[out] buffer for the compacted node data
+ * @return uint32_t compacted node data length
+ */
+uint32_t ldb_vacuum_node_groups(struct ldb_table table, uint8_t *node, uint32_t node_ln, uint8_t *out)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint32_t out_ln = 0;
+	uint32_t ptr = 0;
+
+	while (ptr + subkey_ln + 2 <= node_ln)
+	{
+		uint32_t group_ln = subkey_ln + 2 + uint16_read(node + ptr + subkey_ln);
+		if (ptr + group_ln > node_ln) break;
+
+		if (!ldb_vacuum_dead_subkey(node + ptr, subkey_ln))
+		{
+			memcpy(out + out_ln, node + ptr, group_ln);
+			out_ln += group_ln;
+		}
+		ptr += group_ln;
+	}
+
+	return out_ln;
+}
+
+/**
+ * @brief Reads the live nodes of a list into a buffer
+ *
+ * @param table table struct config
+ * @param ldb_sector open sector
+ * @param key list key
+ * @param list list pointer (from the map)
+ * @param node buffer for node data
+ * @param groups buffer for compacted node data
+ * @param out[out] compacted list
+ * @param live[out] bytes taken by the compacted list in a sector
+ * @return int 1 if the list holds dead data, 0 if it does not, -1 if it is corrupted
+ */
+int ldb_vacuum_read_list(struct ldb_table table, FILE *ldb_sector, uint8_t *key, uint64_t list, uint8_t *node, uint8_t *groups, struct ldb_record_buffer *out, uint64_t *live)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint64_t ptr = list + LDB_PTR_LN;
+	bool dirty = false;
+
+	out->ln = 0;
+	*live = LDB_PTR_LN;
+
+	while (ptr)
+	{
+		uint32_t size = 0;
+		uint64_t next = ldb_node_skip(NULL, table, ldb_sector, ptr, key, &size);
+
+		/* Zero-size nodes are dead */
+		if (!size) dirty = true;
+		else
+		{
+			uint32_t data_ln = table.rec_ln ? subkey_ln + size * table.rec_ln : size;
+			uint32_t stored_ln = (data_ln > LDB_MAX_NODE_LN + LDB_MAX_REC_LN) ? 0 : ldb_node_data_read(table, ldb_sector, data_ln, node);
+			if (!stored_ln)
+			{
+				printf("%02x%02x%02x%02x: Corrupted node\n", key[0], key[1], key[2], key[3]);
+				out->ln = 0;
+				return -1;
+			}
+
+			/* Fixed-length records share the node subkey */
+			if (table.rec_ln)
+			{
+				if (ldb_vacuum_dead_subkey(node, subkey_ln)) dirty = true;
+				else
+				{
+					ldb_vacuum_add_node(out, node, data_ln, size);
+					*live += LDB_PTR_LN + table.ts_ln + stored_ln;
+				}
+			}
+
+			/* Variable-length nodes hold groups of records, each with its own subkey */
+			else
+			{
+				uint32_t groups_ln = subkey_ln ? ldb_vacuum_node_groups(table, node, data_ln, groups) : data_ln;
+				if (groups_ln != data_ln) dirty = true;
+				if (groups_ln)
+				{
+					ldb_vacuum_add_node(out, subkey_ln ? groups : node, groups_ln, 0);
+					*live += LDB_PTR_LN + table.ts_ln + (uint64_t) stored_ln * groups_ln / data_ln;
+				}
+			}
+		}
+		ptr = next;
+	}
+
+	if (!out->ln) *live = 0;
+	return dirty ? 1 : 0;
+}
+
+/**
+ * @brief Writes a compacted list as a new list for key. The map pointer for key must be zero.
+ *
+ * @param table table struct config
+ * @param ldb_sector open sector
+ * @param key list key
+ * @param list compacted list
+ */
+void ldb_vacuum_write_list(struct ldb_table table, FILE *ldb_sector, uint8_t *key, struct ldb_record_buffer *list)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint8_t full_key[256];
+	memcpy(full_key, key, LDB_KEY_LN);
+
+	uint64_t ptr = 0;
+	while (ptr < list->ln)
+	{
+		uint32_t data_ln = uint32_read(list->data + ptr);
+		uint32_t records = uint32_read(list->data + ptr + 4);
+		uint8_t *data = list->data + ptr + 8;
+		ptr += 8 + data_ln;
+
+		/* The node subkey is written by ldb_node_write from the key */
+		memcpy(full_key + LDB_KEY_LN, data, subkey_ln);
+		ldb_node_write(table, ldb_sector, full_key, data + subkey_ln, data_ln - subkey_ln, records);
+	}
+}
+
+/**
+ * @brief Vacuums a sector. Lists holding dead data are replaced by a compacted copy, and the sector is
+ * rewritten if its dead space exceeds LDB_VACUUM_REWRITE percent.
+ *
+ * @param table table struct config
+ * @param k0 sector number
+ * @param stats[in,out] lists rewritten and sectors rewritten
+ */
+void ldb_vacuum_sector(struct ldb_table table, uint8_t k0, uint64_t *stats)
+{
+	uint8_t key[LDB_KEY_LN] = {k0, 0, 0, 0};
+
+	/* Opening with "r+" would create a missing sector */
+	FILE *ldb_sector = ldb_open(table, key, "r");
+	if (!ldb_sector) return;
+	fclose(ldb_sector);
+
+	ldb_sector = ldb_open(table, key, "r+");
+	if (!ldb_sector) return;
+
+	fseeko64(ldb_sector, 0, SEEK_END);
+	uint64_t data_size = ftello64(ldb_sector) - LDB_MAP_SIZE;
+
+	/* Read the map, collecting the lists (map position, plus bit 31 for lists with dead data) */
+	uint32_t count = 0;
+	uint32_t size = 1024;
+	uint32_t *lists = malloc(size * sizeof(uint32_t));
+	uint64_t live = 0;
+	uint64_t compacted = 0;
+	bool corrupted = false;
+	struct ldb_record_buffer list = {NULL, 0, 0};
+	uint8_t *node = malloc(LDB_MAX_NODE_LN + LDB_MAX_REC_LN);
+	uint8_t *groups = malloc(LDB_MAX_NODE_LN + LDB_MAX_REC_LN);
+
+	int chunk = 65536 * LDB_PTR_LN;
+	uint8_t *map = malloc(chunk);
+
+	for (uint64_t map_ptr = 0; map_ptr < LDB_MAP_SIZE; map_ptr += chunk)
+	{
+		fseeko64(ldb_sector, map_ptr, SEEK_SET);
+		if (fread(map, 1, chunk, ldb_sector) != chunk) break;
+
+		for (int i = 0; i < chunk; i += LDB_PTR_LN)
+		{
+			uint64_t list_ptr = uint40_read(map + i);
+			if (!list_ptr) continue;
+
+			uint32_t pos = (map_ptr + i) / LDB_PTR_LN;
+			key[1] = (pos >> 16) & 0xff;
+			key[2] = (pos >> 8) & 0xff;
+			key[3] = pos & 0xff;
+
+			uint64_t list_live = 0;
+			int state = ldb_vacuum_read_list(table, ldb_sector, key, list_ptr, node, groups, &list, &list_live);
+			if (state < 0) corrupted = true;
+			live += list_live;
+
+			if (count == size)
+			{
+				size *= 2;
+				lists = realloc(lists, size * sizeof(uint32_t));
+			}
+			lists[count++] = pos | (state > 0 ? 0x80000000 : 0);
+		}
+	}
+	free(map);
+
+	/* Choose between replacing dirty lists and rewriting the whole sector (which would drop corrupted lists) */
+	bool rewrite = !corrupted && data_size && (data_size - live) * 100 / data_size >= LDB_VACUUM_REWRITE;
+
+	struct ldb_table out_table = table;
+	FILE *out_sector = ldb_sector;
+	if (rewrite)
+	{
+		/* A .tmp left by an interrupted run would be reused by ldb_open, remove it first */
+		char tmp[LDB_MAX_PATH];
+		ldb_checkpoint_sector_path(table, k0, "tmp", tmp);
+		if (ldb_file_exists(tmp)) unlink(tmp);
+
+		out_table.tmp = true;
+		out_sector = ldb_open(out_table, key, "r+");
+		if (!out_sector) ldb_error("E074 Error creating .tmp sector");
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bool dirty = lists[i] & 0x80000000;
+		if (!dirty && !rewrite) continue;
+
+		uint32_t pos = lists[i] & 0xffffff;
+		key[1] = (pos >> 16) & 0xff;
+		key[2] = (pos >> 8) & 0xff;
+		key[3] = pos & 0xff;
+
+		uint64_t list_live = 0;
+		if (ldb_vacuum_read_list(table, ldb_sector, key, ldb_list_pointer(ldb_sector, key), node, groups, &list, &list_live) < 0) continue;
+
+		if (!rewrite) ldb_list_unlink(ldb_sector, key);
+		if (list.ln) ldb_vacuum_write_list(out_table, out_sector, key, &list);
+		else ldb_bitmap_log(table, key, false);
+
+		if (dirty) compacted++;
+	}
+
+	free(node);
+	free(groups);
+	free(list.data);
+	free(lists);
+
+	if (rewrite) fclose(out_sector);
+	fclose(ldb_sector);
+	ldb_dict_sync();
+
+	if (rewrite) ldb_sector_update(table, key);
+
+	/* Index pointers are no longer valid */
+	if (table.index && (rewrite || compacted)) ldb_index_drop(table, key);
+
+	stats[0] += compacted;
+	stats[1] += rewrite;
+
+	printf("%02x: %'lu bytes of %'lu are live%s\n", k0, live, data_size, rewrite ? ", sector rewritten" : "");
+}
+
+/**
+ * @brief Vacuums all sectors of a table
+ *
+ * @param table table struct config
+ */
+void ldb_vacuum(struct ldb_table table)
+{
+	uint64_t stats[2] = {0, 0};
+
+	/* Compacted lists keep their records interned */
+	if (table.intern && !table.rec_ln) ldb_dict_writer_open(table);
+
+	for (int k0 = 0; k0 < 256; k0++) ldb_vacuum_sector(table, k0, stats);
+
+	ldb_dict_writer_close();
+
+	printf("Vacuum completed with %'lu lists compacted and %'lu sectors rewritten\n", stats[0], stats[1]);
+}
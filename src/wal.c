@@ -0,0 +1,927 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * src/wal.c
+ *
+ * Write-ahead log for table inserts
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file wal.c
+  * @date 18 Oct 2026
+  * @brief Write-ahead log (WAL) for inserts into tables with the "wal" option
+
+  * Inserts are appended to DBNAME/TABLENAME.wal and made durable with a single fdatasync shared among
+  * concurrent writers (group commit). The log is applied into the sectors in large batches, sorted by
+  * sector and map position, so that the random seeks of ldb_update_list_pointers() are paid once per list
+  * instead of once per insert.
+
+  * WAL ENTRY STRUCTURE
+  * L = 32-bit length of R + K + D
+  * R = 16-bit number of records (fixed-length records), or zero for variable-length data
+  * K = full table key (key_ln bytes)
+  * D = node data, as passed to ldb_node_write()
+  * C = 32-bit CRC of R + K + D. A torn entry at the end of the log is discarded on replay.
+
+  * The offset up to which the log is known to be on disk is kept in DBNAME/TABLENAME.wal.sync, and the
+  * progress of an apply in DBNAME/TABLENAME.wal.applied.
+
+  * Until they are applied, logged inserts are read from an in-memory copy of the log, which is reloaded
+  * whenever the log changes. Readers hold a shared flock on the log while reading a list, which keeps it
+  * from being applied halfway through.
+  * @see https://github.com/scanoss/ldb/blob/master/src/wal.c
+  */
+
+struct ldb_wal_entry
+{
+	uint8_t *key;
+	uint8_t *data;
+	uint32_t data_ln;
+	uint16_t records;
+	long seq;
+	uint64_t offset; // position of the entry in the log
+};
+
+struct ldb_wal_applied
+{
+	uint64_t start; // entries before this offset are all in their sectors
+	uint64_t size;  // end of the batch being applied
+	uint32_t crc;   // C of the last entry in the batch, telling this log from a later one
+	int32_t sector; // last sector of the batch written and synced, -1 for none
+};
+
+struct ldb_wal_cache
+{
+	char path[LDB_MAX_PATH];
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	uint8_t *log;
+	struct ldb_wal_entry *entries; // pending entries, sorted by 32-bit key and log order
+	long count;
+};
+
+struct ldb_wal_cache ldb_wal_cache[LDB_WAL_CACHE];
+int ldb_wal_cache_next = 0;
+pthread_mutex_t ldb_wal_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+char **ldb_wal_recovered = NULL;
+int ldb_wal_recovered_count = 0;
+pthread_mutex_t ldb_wal_recover_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Returns the path for a table log file
+ *
+ * @param table table struct
+ * @param path[out] output path (LDB_MAX_PATH)
+ * @param ext file extension
+ */
+void ldb_wal_path(struct ldb_table table, char *path, char *ext)
+{
+	sprintf(path, "%s/%s/%s.%s", ldb_root, table.db, table.table, ext);
+}
+
+/**
+ * @brief Makes sure that the log is on disk at least up to offset. A writer that waited for
+ * another writer's fdatasync will usually find its own entry covered and return without syncing.
+ *
+ * @param table table struct
+ * @param wal_fd file descriptor of the log
+ * @param offset end of the entry that must be durable
+ */
+void ldb_wal_sync(struct ldb_table table, int wal_fd, uint64_t offset)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal.sync");
+
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		if (fdatasync(wal_fd)) ldb_error("E077 Cannot sync write-ahead log");
+		return;
+	}
+
+	flock(fd, LOCK_EX);
+
+	uint64_t synced = 0;
+	if (pread(fd, &synced, sizeof(synced), 0) != sizeof(synced)) synced = 0;
+
+	if (synced < offset)
+	{
+		/* Everything appended before this point is covered by the sync */
+		uint64_t size = lseek(wal_fd, 0, SEEK_END);
+		if (fdatasync(wal_fd)) ldb_error("E077 Cannot sync write-ahead log");
+		if (pwrite(fd, &size, sizeof(size), 0) != sizeof(size)) printf("Warning: cannot update %s\n", path);
+	}
+
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/**
+ * @brief Appends a node to the table log and returns once it is durable. The log is applied into
+ * the sectors when it reaches LDB_WAL_BATCH bytes, unless the table is locked for maintenance.
+ *
+ * @param table table struct
+ * @param key full table key
+ * @param data node data (as for ldb_node_write)
+ * @param dataln length of data
+ * @param records number of records (fixed-length records), zero for variable-length data
+ * @return true if the entry was logged
+ */
+bool ldb_wal_append(struct ldb_table table, uint8_t *key, uint8_t *data, uint32_t dataln, uint16_t records)
+{
+	if (dataln > LDB_MAX_NODE_LN) ldb_error ("E053 Data record size exceeded");
+
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal");
+
+	/* Assemble entry: L, R, K, D and C */
+	uint32_t entry_ln = 2 + table.key_ln + dataln;
+	uint8_t *entry = malloc(entry_ln + 8);
+	uint32_write(entry, entry_ln);
+	uint16_write(entry + 4, records);
+	memcpy(entry + 6, key, table.key_ln);
+	memcpy(entry + 6 + table.key_ln, data, dataln);
+	uint32_write(entry + 4 + entry_ln, (uint32_t) crc32(0, entry + 4, entry_ln));
+
+	int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		printf("E077 Cannot open write-ahead log %s\n", path);
+		free(entry);
+		return false;
+	}
+
+	/* Append entry, removing any partial write */
+	flock(fd, LOCK_EX);
+	off_t start = lseek(fd, 0, SEEK_END);
+	bool out = (write(fd, entry, entry_ln + 8) == entry_ln + 8);
+	if (!out) if (ftruncate(fd, start)) printf("Warning: cannot truncate %s\n", path);
+	uint64_t offset = lseek(fd, 0, SEEK_END);
+	flock(fd, LOCK_UN);
+
+	if (out) ldb_wal_sync(table, fd, offset);
+	else printf("E077 Cannot write into write-ahead log %s\n", path);
+
+	close(fd);
+	free(entry);
+
+	/* Once the log has grown into a large batch, apply it into the sectors. Reads are served from the log
+	   meanwhile, so it can wait for the end of a collate */
+	if (out && offset >= LDB_WAL_BATCH) ldb_wal_apply_try(table, false);
+
+	return out;
+}
+
+/**
+ * @brief Sets the offset up to which the log is known to be on disk
+ *
+ * @param table table struct
+ * @param offset synced offset
+ */
+void ldb_wal_sync_reset(struct ldb_table table, uint64_t offset)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal.sync");
+
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) return;
+
+	flock(fd, LOCK_EX);
+	if (pwrite(fd, &offset, sizeof(offset), 0) != sizeof(offset)) printf("Warning: cannot update %s\n", path);
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/**
+ * @brief Sort log entries by sector, map position and then log order
+ *
+ * @param a entry a
+ * @param b entry b
+ * @return 1 if a goes after b, -1 if a goes before b, 0 if they are equal
+ */
+int ldb_wal_entry_cmp(const void *a, const void *b)
+{
+	const struct ldb_wal_entry *ea = a;
+	const struct ldb_wal_entry *eb = b;
+
+	if (ea->key[0] != eb->key[0]) return (ea->key[0] > eb->key[0]) ? 1 : -1;
+
+	uint64_t pa = ldb_map_pointer_pos(ea->key);
+	uint64_t pb = ldb_map_pointer_pos(eb->key);
+	if (pa != pb) return (pa > pb) ? 1 : -1;
+
+	if (ea->seq != eb->seq) return (ea->seq > eb->seq) ? 1 : -1;
+	return 0;
+}
+
+/**
+ * @brief Sort log entries by 32-bit key and then log order
+ *
+ * @param a entry a
+ * @param b entry b
+ * @return 1 if a goes after b, -1 if a goes before b, 0 if they are equal
+ */
+int ldb_wal_key_cmp(const void *a, const void *b)
+{
+	const struct ldb_wal_entry *ea = a;
+	const struct ldb_wal_entry *eb = b;
+
+	int cmp = memcmp(ea->key, eb->key, LDB_KEY_LN);
+	if (cmp) return cmp;
+
+	if (ea->seq != eb->seq) return (ea->seq > eb->seq) ? 1 : -1;
+	return 0;
+}
+
+/**
+ * @brief Reads the log into an array of entries, stopping at a torn entry at its end
+ *
+ * @param table table struct
+ * @param log log contents
+ * @param size log size
+ * @param count[out] number of entries
+ * @param end[out] end of the last complete entry
+ * @return array of entries
+ */
+struct ldb_wal_entry *ldb_wal_parse(struct ldb_table table, uint8_t *log, uint64_t size, long *count, uint64_t *end)
+{
+	long capacity = 1024;
+	struct ldb_wal_entry *entries = malloc(capacity * sizeof(struct ldb_wal_entry));
+	*count = 0;
+
+	uint64_t ptr = 0;
+	while (ptr + 8 <= size)
+	{
+		uint32_t entry_ln = uint32_read(log + ptr);
+		if (entry_ln < 2 + table.key_ln || ptr + 8 + entry_ln > size) break;
+
+		uint8_t *entry = log + ptr + 4;
+		if (uint32_read(entry + entry_ln) != (uint32_t) crc32(0, entry, entry_ln)) break;
+
+		if (*count == capacity)
+		{
+			capacity *= 2;
+			entries = realloc(entries, capacity * sizeof(struct ldb_wal_entry));
+		}
+
+		struct ldb_wal_entry *e = entries + *count;
+		e->records = uint16_read(entry);
+		e->key = entry + 2;
+		e->data = entry + 2 + table.key_ln;
+		e->data_ln = entry_ln - 2 - table.key_ln;
+		e->seq = *count;
+		e->offset = ptr;
+
+		(*count)++;
+		ptr += 8 + entry_ln;
+	}
+
+	*end = ptr;
+	return entries;
+}
+
+/**
+ * @brief Reads the progress of an interrupted apply of the log, if there is one
+ *
+ * @param table table struct
+ * @param log log contents
+ * @param size log size
+ * @param applied[out] progress, which is empty if the log was not being applied
+ * @return true if the log was being applied
+ */
+bool ldb_wal_applied_read(struct ldb_table table, uint8_t *log, uint64_t size, struct ldb_wal_applied *applied)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal.applied");
+
+	bool found = false;
+	int fd = open(path, O_RDONLY);
+	if (fd >= 0)
+	{
+		found = (read(fd, applied, sizeof(*applied)) == sizeof(*applied));
+		close(fd);
+	}
+
+	/* The progress must belong to this log, and not to one which has been emptied since */
+	if (found) found = (applied->size >= 8 && applied->size <= size && applied->start <= applied->size);
+	if (found) found = (uint32_read(log + applied->size - 4) == applied->crc);
+
+	if (!found) *applied = (struct ldb_wal_applied) {0, 0, 0, -1};
+	return found;
+}
+
+/**
+ * @brief Records the progress of an apply of the log
+ *
+ * @param fd file descriptor of DBNAME/TABLENAME.wal.applied
+ * @param applied progress
+ */
+void ldb_wal_applied_write(int fd, struct ldb_wal_applied *applied)
+{
+	if (pwrite(fd, applied, sizeof(*applied), 0) != sizeof(*applied) || fdatasync(fd))
+		ldb_error("E077 Cannot record write-ahead log progress");
+}
+
+/**
+ * @brief Tells if an entry has already been written into its sector
+ *
+ * @param entry log entry
+ * @param applied apply progress
+ * @return true if the entry is in its sector
+ */
+bool ldb_wal_entry_applied(struct ldb_wal_entry *entry, struct ldb_wal_applied *applied)
+{
+	if (entry->offset < applied->start) return true;
+	return (entry->offset < applied->size && entry->key[0] <= applied->sector);
+}
+
+/**
+ * @brief Syncs and closes a sector written from the log, and records it as applied
+ *
+ * @param sector open sector
+ * @param sector_n sector number
+ * @param applied_fd file descriptor of DBNAME/TABLENAME.wal.applied
+ * @param applied apply progress
+ */
+void ldb_wal_sector_close(FILE *sector, int sector_n, int applied_fd, struct ldb_wal_applied *applied)
+{
+	fflush(sector);
+	fsync(fileno(sector));
+	fclose(sector);
+
+	applied->sector = sector_n;
+	ldb_wal_applied_write(applied_fd, applied);
+}
+
+/**
+ * @brief Writes the given log entries into their sectors. Consecutive entries for the same list
+ * are merged into a single node, and every sector is opened and synced only once.
+ *
+ * @param table table struct
+ * @param entries entries sorted with ldb_wal_entry_cmp
+ * @param count number of entries
+ * @param applied_fd file descriptor of DBNAME/TABLENAME.wal.applied
+ * @param applied apply progress, updated after each sector
+ */
+void ldb_wal_write_entries(struct ldb_table table, struct ldb_wal_entry *entries, long count, int applied_fd, struct ldb_wal_applied *applied)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint8_t *node = malloc(LDB_MAX_NODE_LN);
+	FILE *sector = NULL;
+	int current = -1;
+
+	long i = 0;
+	while (i < count)
+	{
+		struct ldb_wal_entry *e = entries + i;
+
+		/* Move to the entry sector */
+		if (e->key[0] != current)
+		{
+			if (sector) ldb_wal_sector_close(sector, current, applied_fd, applied);
+			sector = ldb_open(table, e->key, "r+");
+			if (!sector) ldb_error("E077 Cannot apply write-ahead log");
+			current = e->key[0];
+		}
+
+		memcpy(node, e->data, e->data_ln);
+		uint32_t node_ln = e->data_ln;
+		uint32_t records = e->records;
+
+		/* Merge following entries for the same list */
+		long j = i + 1;
+		for (; j < count; j++)
+		{
+			struct ldb_wal_entry *n = entries + j;
+			if (memcmp(n->key, e->key, LDB_KEY_LN)) break;
+			if (!n->records != !e->records) break;
+
+			/* Fixed-length records share a single K, variable-length datasets carry their own */
+			uint32_t add = n->data_ln;
+			if (records)
+			{
+				if (memcmp(n->key, e->key, table.key_ln)) break;
+				if (records + n->records > 65535) break;
+			}
+			else add += subkey_ln;
+
+			if (node_ln + add + subkey_ln > LDB_MAX_REC_LN - (2 * LDB_PTR_LN) - table.ts_ln) break;
+
+			/* Nodes of fixed-length records are only read up to LDB_MAX_FIXED_NODE_LN */
+			if (records && node_ln + add > (LDB_MAX_FIXED_NODE_LN / table.rec_ln) * table.rec_ln) break;
+
+			if (!records)
+			{
+				memcpy(node + node_ln, n->key + LDB_KEY_LN, subkey_ln);
+				node_ln += subkey_ln;
+			}
+			memcpy(node + node_ln, n->data, n->data_ln);
+			node_ln += n->data_ln;
+			records += n->records;
+		}
+
+		ldb_node_write(table, sector, e->key, node, node_ln, records);
+		i = j;
+	}
+
+	if (sector) ldb_wal_sector_close(sector, current, applied_fd, applied);
+
+	free(node);
+}
+
+/**
+ * @brief Writes the entries of a batch which are not in their sectors yet
+ *
+ * @param table table struct
+ * @param entries log entries
+ * @param count number of entries
+ * @param applied_fd file descriptor of DBNAME/TABLENAME.wal.applied
+ * @param applied batch and its progress
+ */
+void ldb_wal_apply_batch(struct ldb_table table, struct ldb_wal_entry *entries, long count, int applied_fd, struct ldb_wal_applied *applied)
+{
+	struct ldb_wal_entry *batch = malloc((count ? count : 1) * sizeof(struct ldb_wal_entry));
+	long batch_count = 0;
+
+	for (long i = 0; i < count; i++)
+		if (entries[i].offset < applied->size && !ldb_wal_entry_applied(entries + i, applied))
+			batch[batch_count++] = entries[i];
+
+	qsort(batch, batch_count, sizeof(struct ldb_wal_entry), ldb_wal_entry_cmp);
+	ldb_wal_write_entries(table, batch, batch_count, applied_fd, applied);
+	free(batch);
+}
+
+/**
+ * @brief Writes the log into the sectors and empties it. Must be called with the table locked and the
+ * log flocked. Progress is recorded in DBNAME/TABLENAME.wal.applied after each sector is synced, so that
+ * an apply interrupted by a crash is completed from the next sector instead of writing the same entries
+ * twice. Entries logged after the crash are then applied as a new batch.
+ *
+ * @param table table struct
+ * @param fd file descriptor of the log
+ */
+void ldb_wal_apply_log(struct ldb_table table, int fd)
+{
+	uint64_t size = lseek(fd, 0, SEEK_END);
+	if (!size) return;
+
+	/* Readers reload the log, which will no longer match the sectors */
+	futimens(fd, NULL);
+
+	uint8_t *log = malloc(size);
+	if (pread(fd, log, size, 0) != size) ldb_error("E077 Cannot read write-ahead log");
+
+	long count = 0;
+	uint64_t end = 0;
+	struct ldb_wal_entry *entries = ldb_wal_parse(table, log, size, &count, &end);
+	if (end < size) printf("Warning: discarding %lu bytes of incomplete write-ahead log\n", size - end);
+
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal.applied");
+	int applied_fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (applied_fd < 0) ldb_error("E077 Cannot record write-ahead log progress");
+
+	/* Complete an interrupted apply first */
+	struct ldb_wal_applied applied;
+	if (ldb_wal_applied_read(table, log, size, &applied))
+		ldb_wal_apply_batch(table, entries, count, applied_fd, &applied);
+
+	/* Then apply the rest of the log */
+	if (end > applied.size)
+	{
+		applied = (struct ldb_wal_applied) {applied.size, end, uint32_read(log + end - 4), -1};
+		ldb_wal_applied_write(applied_fd, &applied);
+		ldb_wal_apply_batch(table, entries, count, applied_fd, &applied);
+	}
+	close(applied_fd);
+
+	/* Sectors are on disk, the log can be emptied */
+	if (ftruncate(fd, 0)) ldb_error("E077 Cannot truncate write-ahead log");
+	fsync(fd);
+	unlink(path);
+	ldb_wal_sync_reset(table, 0);
+
+	free(entries);
+	free(log);
+}
+
+/**
+ * @brief Applies the table log into the sectors and empties it, unless the table is locked for maintenance
+ * (collate, merge, delete, vacuum). The table is locked as for collate, and writers are blocked while the
+ * log is being applied.
+ *
+ * @param table table struct
+ * @param report print E077 if the table is locked
+ * @return false if the table is locked and the log was left pending
+ */
+bool ldb_wal_apply_try(struct ldb_table table, bool report)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal");
+
+	int fd = open(path, O_RDWR);
+	if (fd < 0) return true;
+
+	bool out = true;
+	if (lseek(fd, 0, SEEK_END))
+	{
+		char dbtable[LDB_MAX_PATH];
+		sprintf(dbtable, "%s/%s", table.db, table.table);
+
+		if (!ldb_lock_try(dbtable))
+		{
+			if (report) printf("E077 Table %s is locked, write-ahead log left pending\n", dbtable);
+			out = false;
+		}
+		else
+		{
+			flock(fd, LOCK_EX);
+			ldb_wal_apply_log(table, fd);
+			flock(fd, LOCK_UN);
+			ldb_unlock(dbtable);
+		}
+	}
+
+	close(fd);
+	return out;
+}
+
+/**
+ * @brief Applies the table log into the sectors and empties it (see ldb_wal_apply_try)
+ *
+ * @param table table struct
+ * @return false if the table is locked for maintenance and the log was left pending
+ */
+bool ldb_wal_apply(struct ldb_table table)
+{
+	return ldb_wal_apply_try(table, true);
+}
+
+/**
+ * @brief Returns the offset up to which the log is known to be on disk, which is normally the end of an entry
+ *
+ * @param table table struct
+ * @return uint64_t synced offset
+ */
+uint64_t ldb_wal_synced(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal.sync");
+
+	uint64_t synced = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+	if (pread(fd, &synced, sizeof(synced), 0) != sizeof(synced)) synced = 0;
+	close(fd);
+	return synced;
+}
+
+/**
+ * @brief Tells if an apply of the log was interrupted, reading only the progress file and the entry it
+ * points to. Must be called with the log flocked.
+ *
+ * @param table table struct
+ * @param fd file descriptor of the log
+ * @param size log size
+ * @return true if an apply is to be completed
+ */
+bool ldb_wal_apply_interrupted(struct ldb_table table, int fd, uint64_t size)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal.applied");
+
+	struct ldb_wal_applied applied;
+	int applied_fd = open(path, O_RDONLY);
+	if (applied_fd < 0) return false;
+	bool found = (read(applied_fd, &applied, sizeof(applied)) == sizeof(applied));
+	close(applied_fd);
+
+	uint8_t crc[4];
+	if (found) found = (applied.size >= 8 && applied.size <= size);
+	if (found) found = (pread(fd, crc, 4, applied.size - 4) == 4 && uint32_read(crc) == applied.crc);
+	return found;
+}
+
+/**
+ * @brief Tells if the log ends with a torn entry. Only the entries after the synced offset are read. Must
+ * be called with the log flocked.
+ *
+ * @param table table struct
+ * @param fd file descriptor of the log
+ * @param size log size
+ * @param full read the whole log instead
+ * @param end[out] end of the last complete entry
+ * @return true if there is a torn entry
+ */
+bool ldb_wal_torn(struct ldb_table table, int fd, uint64_t size, bool full, uint64_t *end)
+{
+	uint64_t start = full ? 0 : ldb_wal_synced(table);
+	if (start > size) start = 0;
+
+	uint8_t *log = malloc(size - start + 1);
+	if (pread(fd, log, size - start, start) != size - start) ldb_error("E077 Cannot read write-ahead log");
+
+	long count = 0;
+	free(ldb_wal_parse(table, log, size - start, &count, end));
+	*end += start;
+
+	free(log);
+	return *end < size;
+}
+
+/**
+ * @brief Removes a torn entry at the end of the log before anything is appended after it, and completes
+ * an apply interrupted by a crash. Done the first time a process opens the table (see ldb_read_cfg).
+ * Whether there is anything to do is decided with the log shared-flocked, reading only the entries logged
+ * after the last sync. A torn entry is cut with the log exclusively flocked. An interrupted apply is only
+ * completed if the table lock can be taken at once, otherwise it is left to the next apply (reads skip the
+ * entries already in their sectors meanwhile).
+ *
+ * @param table table struct
+ */
+void ldb_wal_recover_table(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal");
+
+	pthread_mutex_lock(&ldb_wal_recover_lock);
+	bool recovered = false;
+	for (int i = 0; i < ldb_wal_recovered_count && !recovered; i++)
+		recovered = !strcmp(ldb_wal_recovered[i], path);
+	pthread_mutex_unlock(&ldb_wal_recover_lock);
+	if (recovered) return;
+
+	int fd = open(path, O_RDWR);
+	bool pending = false;
+	if (fd >= 0 && lseek(fd, 0, SEEK_END))
+	{
+		uint64_t end = 0;
+
+		flock(fd, LOCK_SH);
+		uint64_t size = lseek(fd, 0, SEEK_END);
+		bool torn = size && ldb_wal_torn(table, fd, size, false, &end);
+		bool interrupted = size && ldb_wal_apply_interrupted(table, fd, size);
+		flock(fd, LOCK_UN);
+
+		/* The synced offset is only a hint, the whole log is read before cutting it */
+		if (torn)
+		{
+			flock(fd, LOCK_EX);
+			size = lseek(fd, 0, SEEK_END);
+			if (size && ldb_wal_torn(table, fd, size, true, &end))
+			{
+				printf("Warning: discarding %lu bytes of incomplete write-ahead log\n", size - end);
+				if (ftruncate(fd, end)) ldb_error("E077 Cannot truncate write-ahead log");
+				fsync(fd);
+				ldb_wal_sync_reset(table, end);
+			}
+			flock(fd, LOCK_UN);
+		}
+
+		if (interrupted)
+		{
+			printf("Completing write-ahead log apply for %s/%s\n", table.db, table.table);
+			pending = !ldb_wal_apply_try(table, false);
+		}
+	}
+	if (fd >= 0) close(fd);
+
+	/* Try again next time if the apply could not be completed */
+	if (pending) return;
+
+	pthread_mutex_lock(&ldb_wal_recover_lock);
+	ldb_wal_recovered = realloc(ldb_wal_recovered, (ldb_wal_recovered_count + 1) * sizeof(char *));
+	ldb_wal_recovered[ldb_wal_recovered_count++] = strdup(path);
+	pthread_mutex_unlock(&ldb_wal_recover_lock);
+}
+
+/**
+ * @brief Opens the table log and takes a shared lock on it, which keeps the log from being applied while
+ * a list is read from the sectors and then from the log
+ *
+ * @param table table struct
+ * @return int file descriptor of the log, or -1 if there is nothing pending
+ */
+int ldb_wal_read_lock(struct ldb_table table)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal");
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return -1;
+
+	if (lseek(fd, 0, SEEK_END))
+	{
+		flock(fd, LOCK_SH);
+		if (lseek(fd, 0, SEEK_END)) return fd;
+		flock(fd, LOCK_UN);
+	}
+
+	close(fd);
+	return -1;
+}
+
+/**
+ * @brief Releases a log opened with ldb_wal_read_lock
+ *
+ * @param fd file descriptor of the log
+ */
+void ldb_wal_read_unlock(int fd)
+{
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/**
+ * @brief Returns the parsed log of a table, (re)loading it if the log has changed since it was cached.
+ * Entries already written into the sectors by an interrupted apply are left out. Must be called with
+ * the log flocked and ldb_wal_cache_lock held.
+ *
+ * @param table table struct
+ * @param fd file descriptor of the log
+ * @return struct ldb_wal_cache* cached log, or NULL if it cannot be read
+ */
+struct ldb_wal_cache *ldb_wal_cache_get(struct ldb_table table, int fd)
+{
+	char path[LDB_MAX_PATH];
+	ldb_wal_path(table, path, "wal");
+
+	struct stat st;
+	if (fstat(fd, &st)) return NULL;
+
+	struct ldb_wal_cache *cached = NULL;
+	for (int i = 0; i < LDB_WAL_CACHE && !cached; i++)
+		if (!strcmp(ldb_wal_cache[i].path, path)) cached = ldb_wal_cache + i;
+
+	if (cached && cached->dev == st.st_dev && cached->ino == st.st_ino && cached->size == st.st_size &&
+			cached->mtime.tv_sec == st.st_mtim.tv_sec && cached->mtime.tv_nsec == st.st_mtim.tv_nsec) return cached;
+
+	/* Replace the stale copy, or the oldest log */
+	if (!cached)
+	{
+		cached = ldb_wal_cache + ldb_wal_cache_next;
+		ldb_wal_cache_next = (ldb_wal_cache_next + 1) % LDB_WAL_CACHE;
+	}
+	free(cached->log);
+	free(cached->entries);
+	memset(cached, 0, sizeof(struct ldb_wal_cache));
+
+	uint8_t *log = malloc(st.st_size);
+	if (pread(fd, log, st.st_size, 0) != st.st_size)
+	{
+		free(log);
+		return NULL;
+	}
+
+	long count = 0;
+	uint64_t end = 0;
+	struct ldb_wal_entry *entries = ldb_wal_parse(table, log, st.st_size, &count, &end);
+
+	struct ldb_wal_applied applied;
+	ldb_wal_applied_read(table, log, st.st_size, &applied);
+
+	long pending = 0;
+	for (long i = 0; i < count; i++)
+		if (!ldb_wal_entry_applied(entries + i, &applied)) entries[pending++] = entries[i];
+	qsort(entries, pending, sizeof(struct ldb_wal_entry), ldb_wal_key_cmp);
+
+	strcpy(cached->path, path);
+	cached->dev = st.st_dev;
+	cached->ino = st.st_ino;
+	cached->size = st.st_size;
+	cached->mtime = st.st_mtim;
+	cached->log = log;
+	cached->entries = entries;
+	cached->count = pending;
+	return cached;
+}
+
+/**
+ * @brief Passes the records for key which are still in the log to the handler, as ldb_fetch_node_records
+ * does for the nodes that ldb_wal_apply will write. Matching entries are copied out of the cache first, so
+ * that the handler does not run with the cache locked.
+ *
+ * @param table table struct
+ * @param fd file descriptor of the log (see ldb_wal_read_lock)
+ * @param key key of the list
+ * @param skip_subkey true to pass the records for any subkey
+ * @param records[in,out] number of records passed to the handler so far
+ * @param ldb_record_handler handler function
+ * @param void_ptr pointer passed to the handler
+ * @return true if the handler requested to stop
+ */
+bool ldb_wal_fetch(struct ldb_table table, int fd, uint8_t *key, bool skip_subkey, uint32_t *records, bool (*ldb_record_handler) (uint8_t *, uint8_t *, int, uint8_t *, uint32_t, int, void *), void *void_ptr)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint8_t *nodes = NULL;
+	uint64_t nodes_ln = 0;
+
+	pthread_mutex_lock(&ldb_wal_cache_lock);
+	struct ldb_wal_cache *cached = ldb_wal_cache_get(table, fd);
+	if (cached)
+	{
+		/* Locate the first entry for the key */
+		long first = 0;
+		long last = cached->count;
+		while (first < last)
+		{
+			long mid = (first + last) / 2;
+			if (memcmp(cached->entries[mid].key, key, LDB_KEY_LN) < 0) first = mid + 1;
+			else last = mid;
+		}
+
+		last = first;
+		while (last < cached->count && !memcmp(cached->entries[last].key, key, LDB_KEY_LN))
+			nodes_ln += 9 + subkey_ln + cached->entries[last++].data_ln;
+
+		/* Copy each entry as node data (K and the logged data), as ldb_node_write would write it */
+		if (nodes_ln)
+		{
+			nodes = malloc(nodes_ln);
+			uint8_t *node = nodes;
+			for (long i = first; i < last; i++)
+			{
+				struct ldb_wal_entry *e = cached->entries + i;
+				uint32_t node_ln = subkey_ln + e->data_ln;
+				uint32_t node_size = node_ln;
+				if (e->records && e->records * table.rec_ln < node_size) node_size = e->records * table.rec_ln;
+
+				uint32_write(node, node_ln);
+				uint32_write(node + 4, node_size);
+				memcpy(node + 8, e->key + LDB_KEY_LN, subkey_ln);
+				memcpy(node + 8 + subkey_ln, e->data, e->data_ln);
+				node[8 + node_ln] = 0;
+				node += 9 + node_ln;
+			}
+		}
+	}
+	pthread_mutex_unlock(&ldb_wal_cache_lock);
+
+	bool done = false;
+	for (uint8_t *node = nodes; node < nodes + nodes_ln && !done; node += 9 + uint32_read(node))
+		done = ldb_fetch_node_records(table, key, skip_subkey, node + 8, uint32_read(node + 4), records, ldb_record_handler, void_ptr);
+
+	free(nodes);
+	return done;
+}
+
+/**
+ * @brief Replays pending logs for all tables in all databases
+ */
+void ldb_wal_recover(void)
+{
+	DIR *root = opendir(ldb_root);
+	if (!root) return;
+
+	struct dirent *db;
+	while ((db = readdir(root)) != NULL)
+	{
+		if (db->d_name[0] == '.') continue;
+
+		char path[LDB_MAX_PATH];
+		sprintf(path, "%s/%s", ldb_root, db->d_name);
+
+		DIR *dir = opendir(path);
+		if (!dir) continue;
+
+		struct dirent *ent;
+		while ((ent = readdir(dir)) != NULL)
+		{
+			int ln = strlen(ent->d_name);
+			if (ln < 5 || strcmp(ent->d_name + ln - 4, ".wal")) continue;
+
+			char db_table[LDB_MAX_PATH];
+			sprintf(db_table, "%s/%.*s", db->d_name, ln - 4, ent->d_name);
+
+			sprintf(path, "%s/%s/%s", ldb_root, db->d_name, ent->d_name);
+			if (!ldb_file_size(path)) continue;
+
+			struct ldb_table table = ldb_read_cfg(db_table);
+			if (table.wal)
+			{
+				printf("Replaying write-ahead log for %s\n", db_table);
+				ldb_wal_apply(table);
+			}
+		}
+		closedir(dir);
+	}
+	closedir(root);
+}
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * test/codec.c
+ *
+ * Round-trip tests for packed node data
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file codec.c
+  * @date 18 Oct 2026
+  * @brief Packs node data of variable-length tables and checks that it is restored byte for byte
+
+  * Node data is built with narrow and wide subkeys sharing leading bytes, and with record bodies which
+  * repeat within the node, so that every encoding has something to do. Each case runs front-coding,
+  * dictionary interning and ldb_node_pack/ldb_node_unpack with the options of the table. The dictionary
+  * is written to DBNAME/TABLENAME.dict under the LDB root, in the database given as argument.
+  * @see https://github.com/scanoss/ldb/blob/master/test/codec.c
+  */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../src/ldb.h"
+
+int failed = 0;
+
+/**
+ * @brief Reports a test result
+ *
+ * @param name test name
+ * @param ok test result
+ */
+void check(char *name, bool ok)
+{
+	printf("%s %s\n", ok ? "OK  " : "FAIL", name);
+	if (!ok) failed++;
+}
+
+/**
+ * @brief Builds node data (K, GS and R) with subkeys sharing leading bytes and repeated record bodies
+ *
+ * @param table table struct config
+ * @param out[out] node data
+ * @return uint32_t node data size
+ */
+uint32_t build_node(struct ldb_table table, uint8_t *out)
+{
+	int subkey_ln = table.key_ln - LDB_KEY_LN;
+	uint32_t size = 0;
+
+	for (int group = 0; group < 24; group++)
+	{
+		/* Subkeys differ in their last two bytes only */
+		memset(out + size, 0xa5, subkey_ln);
+		if (subkey_ln) out[size + subkey_ln - 1] = group;
+		if (subkey_ln > 1) out[size + subkey_ln - 2] = group / 8;
+		size += subkey_ln;
+
+		uint32_t gs_ptr = size;
+		size += 2;
+
+		for (int record = 0; record < 5; record++)
+		{
+			char body[64];
+			int ln = 0;
+			if (record < 2) ln = sprintf(body, "repeated record body %d shared by the groups", record);
+			else if (record == 2) ln = sprintf(body, "r%d", group);
+			else ln = sprintf(body, "unique record body for group %d, record %d", group, record);
+
+			uint16_write(out + size, ln);
+			memcpy(out + size + 2, body, ln);
+			size += 2 + ln;
+		}
+		uint16_write(out + gs_ptr, size - gs_ptr - 2);
+	}
+	return size;
+}
+
+/**
+ * @brief Runs the round trips for a table layout
+ *
+ * @param table table struct config
+ * @param name case name
+ */
+void test_table(struct ldb_table table, char *name)
+{
+	char test[256];
+	uint8_t *data = malloc(LDB_MAX_NODE_LN);
+	uint8_t *work = malloc(2 * LDB_MAX_NODE_LN + 8);
+	uint8_t *out = malloc(LDB_MAX_NODE_LN);
+	uint32_t size = build_node(table, data);
+
+	/* Front-coding */
+	uint32_t coded_ln = ldb_node_frontcode(table, data, size, work, false);
+	sprintf(test, "%s frontcode shrinks node data", name);
+	check(test, coded_ln && coded_ln < size);
+	sprintf(test, "%s frontdecode restores node data", name);
+	check(test, ldb_node_frontdecode(table, work, coded_ln, out, size, false) && !memcmp(out, data, size));
+
+	/* Interning, with a fresh dictionary */
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/%s/%s.dict", ldb_root, table.db, table.table);
+	unlink(path);
+	ldb_dict_writer_open(table);
+
+	uint32_t interned_ln = ldb_dict_intern(table, data, size, work);
+	ldb_dict_sync();
+	sprintf(test, "%s intern shrinks node data", name);
+	check(test, interned_ln && interned_ln < size);
+	sprintf(test, "%s resolve restores node data", name);
+	check(test, ldb_dict_resolve(table, work, interned_ln, out, size) && !memcmp(out, data, size));
+
+	/* Interned data is front-coded too */
+	uint8_t *coded = malloc(2 * LDB_MAX_NODE_LN);
+	coded_ln = ldb_node_frontcode(table, work, interned_ln, coded, true);
+	sprintf(test, "%s frontdecode restores interned data", name);
+	check(test, coded_ln && ldb_node_frontdecode(table, coded, coded_ln, out, interned_ln, true) && !memcmp(out, work, interned_ln));
+	free(coded);
+
+	/* Packing with each combination of options */
+	for (int options = 1; options < 8; options++)
+	{
+		table.compress = options & 1;
+		table.frontcode = options & 2;
+		table.intern = options & 4;
+
+		memcpy(work, data, size);
+		uint32_t packed_ln = ldb_node_pack(table, work, size);
+		uint32_t zs = uint32_read(work);
+
+		sprintf(test, "%s pack%s%s%s", name, table.compress ? " compress" : "", table.frontcode ? " frontcode" : "", table.intern ? " intern" : "");
+		check(test, packed_ln < size && (zs & ~LDB_DICT_NODE) == packed_ln - 4);
+		strcat(test, ", unpack");
+		memset(out, 0, size);
+		check(test, ldb_node_unpack(table, work + 4, zs, out, size) && !memcmp(out, data, size));
+	}
+
+	ldb_dict_writer_close();
+	unlink(path);
+
+	/* Corrupted data is rejected rather than returned */
+	table.compress = true;
+	table.frontcode = true;
+	table.intern = false;
+	memcpy(work, data, size);
+	uint32_t packed_ln = ldb_node_pack(table, work, size);
+	work[packed_ln / 2] ^= 0xff;
+	sprintf(test, "%s unpack rejects corrupted data", name);
+	check(test, !ldb_node_unpack(table, work + 4, uint32_read(work), out, size));
+
+	free(data);
+	free(work);
+	free(out);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2)
+	{
+		printf("Usage: codec DBNAME\n");
+		return 1;
+	}
+
+	struct ldb_table table;
+	memset(&table, 0, sizeof(table));
+	strcpy(table.db, argv[1]);
+	strcpy(table.table, "codec");
+	table.ts_ln = 2;
+
+	char path[LDB_MAX_PATH];
+	sprintf(path, "%s/%s", ldb_root, table.db);
+	mkdir(path, 0755);
+
+	/* Subkeys of none, two and twenty-eight bytes */
+	int key_ln[] = {4, 6, 32};
+	for (int i = 0; i < 3; i++)
+	{
+		char name[32];
+		table.key_ln = key_ln[i];
+		sprintf(name, "key_ln %d:", key_ln[i]);
+		test_table(table, name);
+	}
+
+	rmdir(path);
+	printf("%d failed\n", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+# test/test.sh
+#
+# Runs the codec round trips and the write-ahead log test, then checks that packed tables (intern,
+# frontcode and compress) return the same records as a plain table after collate, vacuum and merge,
+# and that a resumed collate rebuilds the key presence bitmap.
+# Run from the repository root after make.
+# Tables are created in the ldbtest database, which is removed at the end.
+
+DB=ldbtest
+LDB=./ldb
+FAILED=0
+
+ldb() { echo "$1" | $LDB; }
+
+check()
+{
+	if [ -n "$2" ] && [ "$2" == "$3" ]; then echo "OK   $1"; else echo "FAIL $1"; FAILED=$((FAILED + 1)); fi
+}
+
+# Records of all the keys, as printed by select
+records()
+{
+	for key in $KEYS; do ldb "select from $DB/$1 key $key ascii"; done
+}
+
+rm -rf /var/lib/ldb/$DB
+test/codec $DB || FAILED=$((FAILED + 1))
+
+ldb "create database $DB" > /dev/null
+test/wal $DB || FAILED=$((FAILED + 1))
+
+# Narrow (2 bytes) and wide (12 bytes) subkeys
+for key_ln in 6 16; do
+	sub_ln=$(( (key_ln - 4) * 2 ))
+	ldb "create table $DB/plain$key_ln keylen $key_ln reclen 0" > /dev/null
+	ldb "create table $DB/packed$key_ln keylen $key_ln reclen 0" > /dev/null
+	ldb "create table $DB/merged$key_ln keylen $key_ln reclen 0" > /dev/null
+	for option in intern frontcode compress; do
+		ldb "alter table $DB/packed$key_ln set $option" > /dev/null
+		ldb "alter table $DB/merged$key_ln set $option" > /dev/null
+	done
+
+	KEYS=""
+	for list in 01 02 03 04; do
+		for sub in 1 2 3; do
+			key=0a0000$list$(printf "%0${sub_ln}x" $sub)
+			for rec in 1 2 3; do
+				for table in plain packed; do
+					ldb "insert into $DB/$table$key_ln key $key ascii record-body-$rec-repeated-across-the-lists" > /dev/null
+					ldb "insert into $DB/$table$key_ln key $key ascii unique-record-$list-$sub-$rec" > /dev/null
+				done
+			done
+		done
+		KEYS="$KEYS 0a0000$list"
+	done
+
+	ldb "collate $DB/plain$key_ln max 1024" > /dev/null
+	ldb "collate $DB/packed$key_ln max 1024" > /dev/null
+	expected=$(records plain$key_ln)
+	check "key_ln $key_ln: collate" "$expected" "$(records packed$key_ln)"
+	[ -s /var/lib/ldb/$DB/packed$key_ln.dict ]
+	check "key_ln $key_ln: dictionary written" 0 $?
+
+	# Vacuum rewrites the sector once most lists are unlinked
+	for table in plain packed; do
+		for list in 02 03 04; do ldb "unlink list from $DB/$table$key_ln key 0a0000$list" > /dev/null; done
+		rewritten=$(ldb "vacuum $DB/$table$key_ln" | grep -c "sector rewritten")
+	done
+	check "key_ln $key_ln: vacuum rewrites the sector" 1 "$rewritten"
+	expected=$(records plain$key_ln)
+	check "key_ln $key_ln: vacuum" "$expected" "$(records packed$key_ln)"
+
+	ldb "merge $DB/packed$key_ln into $DB/merged$key_ln max 1024" > /dev/null
+	check "key_ln $key_ln: merge" "$expected" "$(records merged$key_ln)"
+done
+
+# A resumed collate keeps the bitmap keys of the sectors collated before the interruption (0a) and
+# of the sectors recovered from their .tmp (0b), although it does not read them again
+ldb "create table $DB/resumed keylen 4 reclen 0" > /dev/null
+ldb "alter table $DB/resumed set bitmap" > /dev/null
+KEYS="0a000001 0a010203 0b000001"
+for key in $KEYS; do ldb "insert into $DB/resumed key $key ascii record-$key" > /dev/null; done
+expected=$(records resumed)
+mv /var/lib/ldb/$DB/resumed/0b.ldb /var/lib/ldb/$DB/resumed/0b.tmp
+printf 'start 0 sectors 2 bytes 0\nsector 0a records 2 bytes 0 seconds 0\n' > /var/lib/ldb/$DB/resumed.collate
+ldb "collate $DB/resumed max 1024" > /dev/null
+[ -s /var/lib/ldb/$DB/resumed.bmp ]
+check "resumed collate: bitmap written" 0 $?
+check "resumed collate: bitmap keeps skipped sectors" "$expected" "$(records resumed)"
+
+rm -rf /var/lib/ldb/$DB
+echo "$FAILED failed"
+[ $FAILED == 0 ]
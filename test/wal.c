@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * test/wal.c
+ *
+ * Write-ahead log tests
+ *
+ * Copyright (C) 2018-2020 SCANOSS.COM
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+  * @file wal.c
+  * @date 18 Oct 2026
+  * @brief Logs inserts through the library and checks that every record is read back, from the log and
+  * once the log is applied into the sectors
+
+  * Fixed-length records logged for the same list are merged into one node when the log is applied, which
+  * must stay within what ldb_node_read returns (LDB_MAX_FIXED_NODE_LN).
+  * @see https://github.com/scanoss/ldb/blob/master/test/wal.c
+  */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/ldb.h"
+
+#define RECORDS 4000
+#define REC_LN 18
+
+int failed = 0;
+
+/**
+ * @brief Reports a test result
+ *
+ * @param name test name
+ * @param ok test result
+ */
+void check(char *name, bool ok)
+{
+	printf("%s %s\n", ok ? "OK  " : "FAIL", name);
+	if (!ok) failed++;
+}
+
+/**
+ * @brief Marks the records passed by ldb_fetch_recordset, which for fixed-length records is the data of
+ * a whole node at a time
+ */
+bool mark_handler(uint8_t *key, uint8_t *subkey, int subkey_ln, uint8_t *data, uint32_t size, int iteration, void *ptr)
+{
+	uint8_t *seen = ptr;
+	for (uint32_t i = 0; i + REC_LN <= size; i += REC_LN)
+	{
+		uint32_t n = uint32_read(data + i);
+		if (n < RECORDS) seen[n] = 1;
+	}
+	return false;
+}
+
+/**
+ * @brief Returns the number of distinct records read for the list
+ *
+ * @param table table struct config
+ * @param key list key
+ * @return uint32_t number of records
+ */
+uint32_t read_records(struct ldb_table table, uint8_t *key)
+{
+	uint8_t seen[RECORDS] = {0};
+	ldb_fetch_recordset(NULL, table, key, false, mark_handler, seen);
+
+	uint32_t count = 0;
+	for (int i = 0; i < RECORDS; i++) count += seen[i];
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2)
+	{
+		printf("Usage: wal DBNAME (an existing database)\n");
+		return 1;
+	}
+
+	char dbtable[LDB_MAX_PATH];
+	sprintf(dbtable, "%s/walfixed", argv[1]);
+
+	ldb_create_table(argv[1], "walfixed", LDB_KEY_LN, REC_LN);
+	struct ldb_table table = ldb_read_cfg(dbtable);
+	table.wal = true;
+	ldb_update_cfg(table);
+	table = ldb_read_cfg(dbtable);
+	check("table has the wal option", table.wal);
+
+	/* More records for one list than a single node of fixed-length records holds */
+	uint8_t key[LDB_KEY_LN] = {0x0a, 0, 0, 1};
+	uint8_t record[REC_LN] = {0};
+	bool logged = true;
+	for (uint32_t i = 0; i < RECORDS && logged; i++)
+	{
+		uint32_write(record, i);
+		logged = ldb_wal_append(table, key, record, REC_LN, 1);
+	}
+	check("records logged", logged);
+
+	check("records read from the log", read_records(table, key) == RECORDS);
+
+	/* A table locked for maintenance keeps its log pending, and the lock is left to its holder */
+	check("table locked", ldb_lock_try(dbtable));
+	check("second lock refused", !ldb_lock_try(dbtable));
+	check("log left pending while locked", !ldb_wal_apply(table));
+	check("lock kept", ldb_locked(dbtable));
+	check("records read while locked", read_records(table, key) == RECORDS);
+	ldb_unlock(dbtable);
+
+	check("log applied", ldb_wal_apply(table));
+	check("table unlocked after apply", !ldb_locked(dbtable));
+
+	check("records read from the sectors", read_records(table, key) == RECORDS);
+
+	printf("%d failed\n", failed);
+	return failed ? 1 : 0;
+}